@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include "./elasticity.h"
+
+namespace model {
+	template<typename T>
+	struct BatchStatistics {
+		size_t steps = 0;
+		size_t point_steps = 0;
+		size_t active_point_steps = 0; // plastic points
+		T last_active_fraction = T(0);
+
+		T active_fraction() const {
+			return point_steps ? T(active_point_steps) / T(point_steps) : T(0);
+		}
+	};
+
+	/*
+		Step of a batch of points with activity masks:
+			- loading of all points
+			- classification of points into active (plastic) and inactive (elastic) sets,
+			  indices of both sets are compacted into dense arrays (allocated once)
+			- elastic response of inactive points (calc_elastic_response: no plastic relation work, no inversion of F_e),
+			  then the full response of active ones over the dense array of their indices
+		the result is the same as the step of each point
+	*/
+	template<typename T>
+	class BatchUpdate {
+		std::vector<size_t> _active;
+		std::vector<size_t> _inactive;
+		BatchStatistics<T> _stat;
+
+	public:
+		const std::vector<size_t>& active() const { return _active; };
+		const std::vector<size_t>& inactive() const { return _inactive; };
+		const BatchStatistics<T>& statistics() const { return _stat; };
+
+		template<class Point>
+		void step(const std::vector<std::shared_ptr<Point>>& points, T dt) {
+			_active.clear();
+			_inactive.clear();
+			_active.reserve(points.size());
+			_inactive.reserve(points.size());
+			for (auto& point : points) {
+				point->init();
+				point->calc_loading(dt);
+			}
+			for (size_t idx = 0; idx < points.size(); ++idx) {
+				(points[idx]->classify(dt) == activity::PLASTIC ? _active : _inactive).push_back(idx);
+			}
+			for (const size_t idx : _inactive) {
+				points[idx]->calc_elastic_response(dt);
+			}
+			for (const size_t idx : _active) {
+				points[idx]->calc_response(dt);
+			}
+			for (auto& point : points) {
+				point->finalize();
+				point->inc_time(dt);
+			}
+			_stat.steps++;
+			_stat.point_steps += points.size();
+			_stat.active_point_steps += _active.size();
+			_stat.last_active_fraction = points.empty() ? T(0) : T(_active.size()) / T(points.size());
+		}
+	};
+};
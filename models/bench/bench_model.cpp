@@ -0,0 +1,253 @@
+#include <sstream>
+#include "../factory.h"
+#include "../../tensor/bench/bench.h"
+
+/*
+	End-to-end throughput and scaling of the models (Elasticity, Plasticity; RATE_CALCULATE, FINITE_CALCULATE)
+	usage: bench_model [--points=1000] [--steps=100] [--dt=1e-6] [--threads=1,2,4] [--scaling=strong|weak|both]
+	                   [--models=elasticity,plasticity] [--schemas=rate,finite] [--params=models/param]
+	                   [--seed=1] [--format=table|csv|json] [--out=file]
+	build: bench_model.cpp ../../tensor/bench/alloc_counter.cpp ../../tensor/utils.cpp (C++20, Eigen in the include path)
+	strong scaling: the same number of points for all thread counts, weak scaling: points per thread
+*/
+
+std::mt19937 gen(42);
+std::uniform_real_distribution<double> unidistr(0.0, 1.0);
+measure::type_schema measure::DEFAULT_NUMERICAL_SCHEMA = measure::type_schema::RATE_CALCULATE;
+
+namespace {
+	using namespace model;
+
+	struct Config {
+		size_t points = 1000;
+		size_t steps = 100;
+		double dt = 1e-6;
+		std::vector<size_t> threads = { 1, 2, 4 };
+		std::vector<std::string> scaling = { "strong", "weak" };
+		std::vector<std::string> models = { "elasticity", "plasticity" };
+		std::vector<std::string> schemas = { "rate", "finite" };
+		std::string params = "models/param";
+		unsigned seed = 1;
+		std::string format = "table";
+		std::string out;
+
+		static std::vector<std::string> split(const std::string& list) {
+			std::vector<std::string> res;
+			std::stringstream stream(list);
+			for (std::string item; std::getline(stream, item, ',');) {
+				if (!item.empty()) res.push_back(item);
+			}
+			return res;
+		}
+
+		static Config parse(int argc, char** argv) {
+			Config config;
+			for (int i = 1; i < argc; ++i) {
+				const std::string arg = argv[i];
+				const auto pos = arg.find('=');
+				if (arg.rfind("--", 0) != 0 || pos == std::string::npos) {
+					throw std::invalid_argument("Unknown argument: " + arg);
+				}
+				const auto key = arg.substr(2, pos - 2);
+				const auto value = arg.substr(pos + 1);
+				if (key == "points") config.points = std::stoul(value);
+				else if (key == "steps") config.steps = std::stoul(value);
+				else if (key == "dt") config.dt = std::stod(value);
+				else if (key == "seed") config.seed = static_cast<unsigned>(std::stoul(value));
+				else if (key == "params") config.params = value;
+				else if (key == "format") config.format = value;
+				else if (key == "out") config.out = value;
+				else if (key == "models") config.models = split(value);
+				else if (key == "schemas") config.schemas = split(value);
+				else if (key == "scaling") config.scaling = value == "both" ? split("strong,weak") : split(value);
+				else if (key == "threads") {
+					config.threads.clear();
+					for (const auto& item : split(value)) config.threads.push_back(std::max<size_t>(1, std::stoul(item)));
+				}
+				else throw std::invalid_argument("Unknown argument: " + arg);
+			}
+			return config;
+		}
+	};
+
+	struct Row {
+		std::string model;
+		std::string schema;
+		std::string scaling;
+		size_t threads = 0;
+		size_t points = 0;
+		size_t steps = 0;
+		double wall_s = 0;
+		double throughput = 0;  // point steps per second
+		double init_s = 0;      // phases, mean over threads
+		double calc_s = 0;
+		double finalize_s = 0;
+		double speedup = 0;     // relative to the first thread count of the series (scaled speedup for weak scaling)
+		double efficiency = 0;
+		double allocs_per_point_step = 0;
+		size_t peak_rss_kb = 0; // process high-water mark after the run
+	};
+
+	using clock = std::chrono::steady_clock;
+
+	double seconds(clock::time_point from, clock::time_point to) {
+		return std::chrono::duration<double>(to - from).count();
+	}
+
+	// steps of points split into contiguous chunks per thread, the phases of a step run over the whole chunk
+	template<class Point>
+	Row run(const std::vector<std::shared_ptr<Point>>& points, size_t steps, double dt, size_t threads) {
+		threads = std::max<size_t>(1, std::min(threads, points.size()));
+		std::vector<std::array<double, 3>> phases(threads, { 0, 0, 0 });
+		std::vector<std::exception_ptr> errors(threads);
+		const auto worker = [&](size_t thread_idx) {
+			try {
+				const size_t begin = thread_idx * points.size() / threads;
+				const size_t end = (thread_idx + 1) * points.size() / threads;
+				auto& phase = phases[thread_idx];
+				for (size_t step = 0; step < steps; ++step) {
+					const auto t0 = clock::now();
+					for (size_t i = begin; i < end; ++i) points[i]->init();
+					const auto t1 = clock::now();
+					for (size_t i = begin; i < end; ++i) points[i]->calc(dt);
+					const auto t2 = clock::now();
+					for (size_t i = begin; i < end; ++i) {
+						points[i]->finalize();
+						points[i]->inc_time(dt);
+					}
+					const auto t3 = clock::now();
+					phase[0] += seconds(t0, t1);
+					phase[1] += seconds(t1, t2);
+					phase[2] += seconds(t2, t3);
+				}
+			} catch (...) {
+				errors[thread_idx] = std::current_exception();
+			}
+		};
+		const size_t allocs = bench::alloc::count();
+		const auto start = clock::now();
+		std::vector<std::thread> pool;
+		for (size_t thread_idx = 1; thread_idx < threads; ++thread_idx) {
+			pool.emplace_back(worker, thread_idx);
+		}
+		worker(0);
+		for (auto& thread : pool) {
+			thread.join();
+		}
+		const double wall = seconds(start, clock::now());
+		for (const auto& error : errors) {
+			if (error) std::rethrow_exception(error);
+		}
+
+		Row row;
+		row.threads = threads;
+		row.points = points.size();
+		row.steps = steps;
+		row.wall_s = wall;
+		row.throughput = wall > 0 ? double(points.size() * steps) / wall : 0;
+		for (const auto& phase : phases) {
+			row.init_s += phase[0] / threads;
+			row.calc_s += phase[1] / threads;
+			row.finalize_s += phase[2] / threads;
+		}
+		row.allocs_per_point_step = double(bench::alloc::count() - allocs) / double(std::max<size_t>(1, points.size() * steps));
+		row.peak_rss_kb = bench::peak_rss_kb();
+		return row;
+	}
+
+	template<template<template<class> class, template<class> class, class> class Model>
+	void run_series(const Config& config, const std::string& model_name, measure::type_schema type, const std::string& schema_name, std::vector<Row>& rows) {
+		const auto prototype = ModelFactory<Model>::template prototype<strain::GradDeform, stress::CaushyStress>(config.params + "/" + model_name + ".json", type);
+		for (const auto& scaling : config.scaling) {
+			const size_t first = rows.size();
+			for (const size_t threads : config.threads) {
+				const size_t count = scaling == "weak" ? config.points * threads : config.points;
+				const auto points = ModelFactory<Model>::clone(*prototype, count, threads, config.seed);
+				auto row = run(points, config.steps, config.dt, threads);
+				row.model = model_name;
+				row.schema = schema_name;
+				row.scaling = scaling;
+				const auto& base = rows.size() > first ? rows[first] : row;
+				const double relative_threads = double(row.threads) / double(base.threads);
+				if (scaling == "weak") {
+					row.efficiency = row.wall_s > 0 ? base.wall_s / row.wall_s : 0;
+					row.speedup = row.efficiency * relative_threads;
+				} else {
+					row.speedup = row.wall_s > 0 ? base.wall_s / row.wall_s : 0;
+					row.efficiency = row.speedup / relative_threads;
+				}
+				rows.push_back(row);
+			}
+		}
+	}
+
+	void write(const Config& config, const std::vector<Row>& rows, std::ostream& out) {
+		if (config.format == "csv") {
+			out << "model,schema,scaling,threads,points,steps,wall_s,throughput,init_s,calc_s,finalize_s,speedup,efficiency,allocs_per_point_step,peak_rss_kb\n";
+			for (const auto& r : rows) {
+				out << r.model << "," << r.schema << "," << r.scaling << "," << r.threads << "," << r.points << "," << r.steps << ","
+					<< r.wall_s << "," << r.throughput << "," << r.init_s << "," << r.calc_s << "," << r.finalize_s << ","
+					<< r.speedup << "," << r.efficiency << "," << r.allocs_per_point_step << "," << r.peak_rss_kb << "\n";
+			}
+		} else if (config.format == "json") {
+			out << "[\n";
+			for (size_t i = 0; i < rows.size(); ++i) {
+				const auto& r = rows[i];
+				out << "  { \"model\": \"" << r.model << "\", \"schema\": \"" << r.schema << "\", \"scaling\": \"" << r.scaling
+					<< "\", \"threads\": " << r.threads << ", \"points\": " << r.points << ", \"steps\": " << r.steps
+					<< ", \"wall_s\": " << r.wall_s << ", \"throughput\": " << r.throughput
+					<< ", \"init_s\": " << r.init_s << ", \"calc_s\": " << r.calc_s << ", \"finalize_s\": " << r.finalize_s
+					<< ", \"speedup\": " << r.speedup << ", \"efficiency\": " << r.efficiency
+					<< ", \"allocs_per_point_step\": " << r.allocs_per_point_step << ", \"peak_rss_kb\": " << r.peak_rss_kb
+					<< " }" << (i + 1 < rows.size() ? "," : "") << "\n";
+			}
+			out << "]\n";
+		} else {
+			out << std::left << std::setw(12) << "model" << std::setw(8) << "schema" << std::setw(8) << "scaling"
+				<< std::right << std::setw(8) << "threads" << std::setw(10) << "points" << std::setw(14) << "steps/s"
+				<< std::setw(10) << "init %" << std::setw(10) << "calc %" << std::setw(10) << "final %"
+				<< std::setw(10) << "speedup" << std::setw(8) << "eff" << std::setw(10) << "allocs" << std::setw(12) << "rss KB" << "\n";
+			for (const auto& r : rows) {
+				const double phases = std::max(1e-30, r.init_s + r.calc_s + r.finalize_s);
+				out << std::left << std::setw(12) << r.model << std::setw(8) << r.schema << std::setw(8) << r.scaling
+					<< std::right << std::setw(8) << r.threads << std::setw(10) << r.points
+					<< std::setw(14) << std::fixed << std::setprecision(0) << r.throughput << std::setprecision(1)
+					<< std::setw(10) << 100 * r.init_s / phases << std::setw(10) << 100 * r.calc_s / phases << std::setw(10) << 100 * r.finalize_s / phases
+					<< std::setprecision(2) << std::setw(10) << r.speedup << std::setw(8) << r.efficiency
+					<< std::setw(10) << r.allocs_per_point_step << std::setw(12) << r.peak_rss_kb << "\n";
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	try {
+		const auto config = Config::parse(argc, argv);
+		std::vector<Row> rows;
+		for (const auto& model_name : config.models) {
+			for (const auto& schema_name : config.schemas) {
+				const auto type = schema_name == "finite" ? measure::type_schema::FINITE_CALCULATE : measure::type_schema::RATE_CALCULATE;
+				if (model_name == "elasticity") {
+					run_series<Elasticity>(config, model_name, type, schema_name, rows);
+				} else if (model_name == "plasticity") {
+					run_series<Plasticity>(config, model_name, type, schema_name, rows);
+				} else {
+					throw std::invalid_argument("Unknown model: " + model_name);
+				}
+			}
+		}
+		if (config.out.empty()) {
+			write(config, rows, std::cout);
+		} else {
+			std::ofstream file(config.out);
+			if (!file.is_open()) {
+				throw std::ios_base::failure("Failed to open file: " + config.out);
+			}
+			write(config, rows, file);
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "bench_model: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,298 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "./factory.h"
+
+namespace model {
+	namespace calibration {
+		// varied param: json pointer into params (e.g. "/flow_treshold", "/elast_modulus/0", "/curve/2/1") and its bounds
+		template<typename T>
+		struct Variable {
+			std::string pointer;
+			T lower;
+			T upper;
+		};
+
+		// samples (x, y) of a run, one per step (see Sweep::Observer)
+		template<typename T>
+		using Response = std::vector<std::pair<T, T>>;
+
+		// the smaller the better
+		template<typename T>
+		using Objective = std::function<T(const Response<T>&)>;
+
+		// mean squared deviation of y from the reference curve, samples out of the reference range are skipped
+		template<typename T>
+		Objective<T> least_squares(const std::shared_ptr<const Curve<T>>& reference) {
+			return [reference](const Response<T>& response) {
+				const T x_min = (*reference)[0].first;
+				const T x_max = (*reference)[reference->size() - 1].first;
+				T sum = T(0);
+				size_t count = 0;
+				for (const auto& [x, y] : response) {
+					if (x < x_min || x > x_max) continue;
+					const T diff = y - reference->value(x);
+					sum += diff * diff;
+					count++;
+				}
+				return count ? sum / T(count) : std::numeric_limits<T>::infinity();
+			};
+		}
+
+		// full factorial design: levels values of every variable evenly over its bounds
+		template<typename T>
+		std::vector<std::vector<T>> grid(const std::vector<Variable<T>>& variables, size_t levels) {
+			if (levels < 2) {
+				throw std::invalid_argument("Calibration: a grid needs at least two levels");
+			}
+			size_t count = 1;
+			for (size_t v = 0; v < variables.size(); ++v) count *= levels;
+			std::vector<std::vector<T>> design(count, std::vector<T>(variables.size()));
+			for (size_t idx = 0; idx < count; ++idx) {
+				size_t rest = idx;
+				for (size_t v = 0; v < variables.size(); ++v) {
+					const T u = T(rest % levels) / T(levels - 1);
+					design[idx][v] = variables[v].lower + u * (variables[v].upper - variables[v].lower);
+					rest /= levels;
+				}
+			}
+			return design;
+		}
+
+		// latin hypercube design of count points: every variable takes each of count strata once
+		template<typename T>
+		std::vector<std::vector<T>> latin_hypercube(const std::vector<Variable<T>>& variables, size_t count, unsigned seed) {
+			std::mt19937 engine(seed);
+			std::uniform_real_distribution<T> uniform(T(0), T(1));
+			std::vector<std::vector<T>> design(count, std::vector<T>(variables.size()));
+			std::vector<size_t> strata(count);
+			for (size_t v = 0; v < variables.size(); ++v) {
+				std::iota(strata.begin(), strata.end(), size_t(0));
+				std::shuffle(strata.begin(), strata.end(), engine);
+				for (size_t idx = 0; idx < count; ++idx) {
+					const T u = (T(strata[idx]) + uniform(engine)) / T(count);
+					design[idx][v] = variables[v].lower + u * (variables[v].upper - variables[v].lower);
+				}
+			}
+			return design;
+		}
+
+		template<typename T>
+		struct Evaluation {
+			std::vector<T> x;
+			T objective = std::numeric_limits<T>::infinity(); // infinity if the run failed
+			numerical_schema::step_status status = numerical_schema::step_status::OK;
+		};
+
+		/*
+			Sweep of a model over variations of params:
+				- params of a design point are the base json with values of variables (no file I/O), parsed and validated per point
+				- a run is steps of a point at the fixed basis, the observer samples the response after every step
+				- design points are run in contiguous ranges per thread, results are in the order of the design
+			invalid params or a failed step (see try_step) give the infinite objective and the status of the run
+		*/
+		template<
+			template<template<class> class, template<class> class, class> class Model,
+			template<class T> class StrainMeasure = strain::GradDeform,
+			template<class T> class StressMeasure = stress::CaushyStress,
+			typename T = double>
+		class Sweep {
+		public:
+			using model_type = Model<StrainMeasure, StressMeasure, T>;
+			using Observer = std::function<std::pair<T, T>(const model_type&)>;
+
+			// intensities of strain and stress
+			static std::pair<T, T> intensities(const model_type& point) {
+				return { point.strain()->value_intensity(), point.stress()->value_intensity() };
+			}
+		private:
+			json _base;
+			std::vector<Variable<T>> _variables;
+			measure::type_schema _type;
+			size_t _steps;
+			T _dt;
+			Observer _observe;
+			Basis<T, 3> _basis;
+
+		public:
+			Sweep(const json& base, const std::vector<Variable<T>>& variables, measure::type_schema type, size_t steps, T dt,
+				const Observer& observe = intensities, const Basis<T, 3>& basis = tens::create_basis<T, 3>()) :
+				_base(base), _variables(variables), _type(type), _steps(steps), _dt(dt), _observe(observe), _basis(basis)
+			{
+				for (const auto& variable : _variables) {
+					if (!_base.contains(json::json_pointer(variable.pointer))) {
+						throw std::invalid_argument("Calibration: param " + variable.pointer + " was not found in base params");
+					}
+					if (!(variable.lower <= variable.upper)) {
+						throw std::invalid_argument("Calibration: bounds of " + variable.pointer + " are not ordered");
+					}
+				}
+			};
+
+			const std::vector<Variable<T>>& variables() const { return _variables; };
+
+			// base params with values of variables
+			json params(const std::vector<T>& x) const {
+				if (x.size() != _variables.size()) {
+					throw std::invalid_argument("Calibration: " + std::to_string(x.size()) + " values for " + std::to_string(_variables.size()) + " variables");
+				}
+				json result = _base;
+				for (size_t v = 0; v < _variables.size(); ++v) {
+					result[json::json_pointer(_variables[v].pointer)] = x[v];
+				}
+				return result;
+			}
+
+			// response of the run at the design point, throws on invalid params
+			Response<T> response(const std::vector<T>& x, numerical_schema::step_status& status) const {
+				model_type point(ModelParams<T>::parse(params(x)), _basis, _type);
+				Response<T> result;
+				result.reserve(_steps);
+				status = numerical_schema::step_status::OK;
+				for (size_t i = 0; i < _steps && status == numerical_schema::step_status::OK; ++i) {
+					status = point.try_step(_dt);
+					if (status == numerical_schema::step_status::OK) {
+						result.push_back(_observe(point));
+					}
+				}
+				return result;
+			}
+
+			Evaluation<T> evaluate(const std::vector<T>& x, const Objective<T>& objective) const {
+				Evaluation<T> result{ x };
+				try {
+					const auto response = this->response(x, result.status);
+					if (result.status == numerical_schema::step_status::OK) {
+						result.objective = objective(response);
+					}
+				} catch (const std::exception&) {
+					// invalid params, errors of the model or of the objective
+					result.status = numerical_schema::step_status::FAILED;
+				}
+				return result;
+			}
+
+			std::vector<Evaluation<T>> run(const std::vector<std::vector<T>>& design, const Objective<T>& objective,
+				size_t threads = std::thread::hardware_concurrency()) const {
+				std::vector<Evaluation<T>> results(design.size());
+				parallel(design.size(), threads, [&](size_t begin, size_t end) {
+					for (size_t idx = begin; idx < end; ++idx) {
+						results[idx] = evaluate(design[idx], objective);
+					}
+				});
+				return results;
+			}
+		};
+
+		template<typename T>
+		struct NelderMeadParams {
+			size_t max_iterations = 200;
+			T tolerance = T(1e-8);    // spread of objective values over the simplex (relative to the best one)
+			T initial_step = T(0.1);  // size of the initial simplex as a fraction of bounds
+		};
+
+		template<typename T>
+		struct Fit {
+			Evaluation<T> best;
+			size_t iterations = 0;
+			size_t evaluations = 0;
+		};
+
+		/*
+			Derivative-free minimization of the objective by the Nelder-Mead simplex in coordinates scaled to bounds
+			(points are clamped to bounds), vertices of the initial simplex and of shrinks are evaluated in parallel
+		*/
+		template<class SweepType, typename T>
+		Fit<T> nelder_mead(const SweepType& sweep, const Objective<T>& objective, const std::vector<T>& x0,
+			const NelderMeadParams<T>& params = NelderMeadParams<T>(), size_t threads = std::thread::hardware_concurrency()) {
+			const auto& variables = sweep.variables();
+			const size_t n = variables.size();
+			if (x0.size() != n) {
+				throw std::invalid_argument("Calibration: initial point has " + std::to_string(x0.size()) + " values for " + std::to_string(n) + " variables");
+			}
+			const auto to_x = [&](const std::vector<T>& u) {
+				std::vector<T> x(n);
+				for (size_t v = 0; v < n; ++v) {
+					x[v] = variables[v].lower + std::clamp(u[v], T(0), T(1)) * (variables[v].upper - variables[v].lower);
+				}
+				return x;
+			};
+			const auto scaled = [&](size_t v) { return variables[v].upper - variables[v].lower; };
+
+			Fit<T> fit;
+			std::vector<std::vector<T>> simplex(n + 1, std::vector<T>(n));
+			for (size_t v = 0; v < n; ++v) {
+				simplex[0][v] = scaled(v) > T(0) ? (x0[v] - variables[v].lower) / scaled(v) : T(0);
+			}
+			for (size_t i = 1; i <= n; ++i) {
+				simplex[i] = simplex[0];
+				simplex[i][i - 1] += simplex[0][i - 1] + params.initial_step <= T(1) ? params.initial_step : -params.initial_step;
+			}
+			std::vector<T> values(n + 1);
+			const auto evaluate_all = [&](size_t first) {
+				std::vector<std::vector<T>> design;
+				for (size_t i = first; i <= n; ++i) design.push_back(to_x(simplex[i]));
+				const auto results = sweep.run(design, objective, threads);
+				for (size_t i = first; i <= n; ++i) values[i] = results[i - first].objective;
+				fit.evaluations += design.size();
+			};
+			const auto evaluate = [&](const std::vector<T>& u) {
+				fit.evaluations++;
+				return sweep.evaluate(to_x(u), objective).objective;
+			};
+			evaluate_all(0);
+
+			std::vector<size_t> order(n + 1);
+			std::vector<T> centroid(n), trial(n), second(n);
+			const auto along = [&](T coef, std::vector<T>& dst) { // centroid + coef * (centroid - worst)
+				for (size_t v = 0; v < n; ++v) dst[v] = std::clamp(centroid[v] + coef * (centroid[v] - simplex[order[n]][v]), T(0), T(1));
+			};
+			for (fit.iterations = 0; fit.iterations < params.max_iterations; ++fit.iterations) {
+				std::iota(order.begin(), order.end(), size_t(0));
+				std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] < values[b]; });
+				const T best = values[order[0]], worst = values[order[n]];
+				if (std::abs(worst - best) <= params.tolerance * (T(1) + std::abs(best))) break;
+
+				std::fill(centroid.begin(), centroid.end(), T(0));
+				for (size_t i = 0; i < n; ++i) {
+					for (size_t v = 0; v < n; ++v) centroid[v] += simplex[order[i]][v] / T(n);
+				}
+				along(T(1), trial); // reflection
+				const T reflected = evaluate(trial);
+				if (reflected < best) {
+					along(T(2), second); // expansion
+					const T expanded = evaluate(second);
+					simplex[order[n]] = expanded < reflected ? second : trial;
+					values[order[n]] = std::min(expanded, reflected);
+				} else if (reflected < values[order[n - 1]]) {
+					simplex[order[n]] = trial;
+					values[order[n]] = reflected;
+				} else {
+					along(reflected < worst ? T(0.5) : T(-0.5), second); // outside or inside contraction
+					const T contracted = evaluate(second);
+					if (contracted < std::min(reflected, worst)) {
+						simplex[order[n]] = second;
+						values[order[n]] = contracted;
+					} else { // shrink to the best vertex
+						const auto best_vertex = simplex[order[0]];
+						for (size_t i = 0; i <= n; ++i) {
+							for (size_t v = 0; v < n; ++v) simplex[i][v] = best_vertex[v] + T(0.5) * (simplex[i][v] - best_vertex[v]);
+						}
+						simplex[0].swap(simplex[order[0]]);
+						values[0] = values[order[0]];
+						evaluate_all(1);
+					}
+				}
+			}
+			const size_t best = std::min_element(values.begin(), values.end()) - values.begin();
+			fit.best = sweep.evaluate(to_x(simplex[best]), objective);
+			fit.evaluations++;
+			return fit;
+		}
+	}
+}
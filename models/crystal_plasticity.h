@@ -0,0 +1,280 @@
+#pragma once
+#include "./elasticity.h"
+#include "./helpers/slip_systems.h"
+
+namespace model {
+	using namespace state;
+	using namespace measure;
+
+	/*
+		Slip-system (crystal) plastic relation G(S) : F_in
+			- resolved shear stresses of all systems from one stress: tau_a = S : P_a (Schmid tensors at the basis of the point)
+			- power-law slip rates: gamma_a = gamma0 * |tau_a / g_a|^(1/m) * sign(tau_a)
+			- plastic velocity gradient: L_in = sum_a gamma_a * P_a
+			- hardening of resistances: dg_a/dt = sum_b h_b * (q + (1 - q) * delta_ab) * |gamma_b|, h_b = h0 * (1 - g_b / g_sat)^a
+		the Cauchy stress is resolved (small elastic strains), resistances are integrated explicitly once per equation call,
+		they are internal variables of the measure (integrators advance them with F_in) and a part of the packed state (checkpoints);
+		a batch of grains (SlipBatch) may compute resolved shear stresses and L_in of all its grains at once,
+		the result is consumed by the next rate/finite equation
+	*/
+	template<template<class> class StressMeasure, template<class> class StrainMeasure, typename T>
+	class SlipRelation : public StrainMeasure<T> {
+	protected:
+		std::shared_ptr<const StressMeasure<T>> S;
+		const std::shared_ptr<const SlipParams<T>> params;
+		const std::shared_ptr<const slip::SchmidTensors<T>> schmid;
+		std::array<T, slip::MAX_SYSTEMS> _g{};     // resistances
+		std::array<T, slip::MAX_SYSTEMS> _g_prev{}; // resistances of the previous step
+		std::array<T, slip::MAX_SYSTEMS> _dg{};    // hardening rates of the last equation
+		std::array<T, slip::MAX_SYSTEMS> _tau{};   // resolved shear stresses
+		std::array<T, slip::MAX_SYSTEMS> _gamma{}; // slip rates
+		std::array<T, slip::MAX_SYSTEMS> _h{};     // hardening of the system b: h_b * |gamma_b|
+		tens::M3x3<T> _L;
+		bool _prepared = false; // _L is given by a batch for the next equation
+
+		void slip_rates() {
+			schmid->resolved_shear(S->value().data(), _tau.data());
+			power_law();
+		}
+
+		// slip rates of resolved shear stresses _tau
+		void power_law() {
+			const T exponent = T(1) / params->rate_sensitivity;
+			for (size_t a = 0; a < systems(); ++a) {
+				const T r = _tau[a] / _g[a];
+				_gamma[a] = params->reference_rate * std::copysign(std::pow(std::abs(r), exponent), r);
+			}
+		}
+
+		void harden(T dt) {
+			T sum = T(0);
+			for (size_t b = 0; b < systems(); ++b) {
+				const T x = T(1) - _g[b] / params->saturation_resistance;
+				_h[b] = params->hardening_modulus * std::copysign(std::pow(std::abs(x), params->hardening_exponent), x) * std::abs(_gamma[b]);
+				sum += _h[b];
+			}
+			const T q = params->latent_ratio;
+			for (size_t a = 0; a < systems(); ++a) {
+				_dg[a] = q * sum + (T(1) - q) * _h[a];
+				_g_prev[a] = _g[a];
+				_g[a] += dt * _dg[a];
+			}
+		}
+	public:
+		SlipRelation(measure::type_schema type, MaterialPoint<T, 3>& state,
+			const std::shared_ptr<const StressMeasure<T>> _S, const std::shared_ptr<const SlipParams<T>>& _params) :
+			StrainMeasure<T>(state, type, "F_in"),
+			S(_S), params(_params), schmid(slip::SchmidTensors<T>::of(_params->systems)), _L(tens::FILL_TYPE::ZERO)
+		{
+			std::fill(_g.begin(), _g.begin() + systems(), params->initial_resistance);
+			_g_prev = _g;
+		};
+
+		size_t systems() const { return schmid->size(); };
+		const slip::SchmidTensors<T>& schmid_tensors() const { return *schmid; };
+		T resistance(size_t a) const { return _g[a]; };
+		T resolved_shear(size_t a) const { return _tau[a]; };
+		T slip_rate(size_t a) const { return _gamma[a]; };
+
+		// batch of grains: resolved shear stresses of the current stress at tau[a * stride], slip rates are written to gamma[a * stride]
+		void take_resolved_shear(const T* tau, size_t stride, T* gamma) {
+			for (size_t a = 0; a < systems(); ++a) _tau[a] = tau[a * stride];
+			power_law();
+			for (size_t a = 0; a < systems(); ++a) gamma[a * stride] = _gamma[a];
+		}
+
+		// batch of grains: L_in of the slip rates at L[c * stride], consumed by the next rate/finite equation
+		void take_velocity_gradient(const T* L, size_t stride) {
+			for (size_t c = 0; c < slip::COMP; ++c) _L.data()[c] = L[c * stride];
+			_prepared = true;
+		}
+
+		virtual void rate_equation(T t, T dt) override {
+			if (_prepared) {
+				this->rate_temp = _L;
+			} else {
+				slip_rates();
+				schmid->velocity_gradient(_gamma.data(), this->rate_temp.data());
+			}
+			_prepared = false;
+			harden(dt);
+		};
+
+		// F_in = (I + L_in * dt).F_in
+		virtual void finite_equation(T t, T dt) override {
+			if (!_prepared) {
+				slip_rates();
+				schmid->velocity_gradient(_gamma.data(), _L.data());
+			}
+			_prepared = false;
+			auto& F_in = this->value_temp = _L;
+			(F_in *= dt) += IDENT_MATRIX<T, 3>;
+			F_in *= this->value();
+			harden(dt);
+		};
+
+		// resistances are integrated by point-wise integrators together with F_in
+		virtual size_t internal_size() const override { return systems(); };
+
+		virtual void internal_at(int k, T* dst) const override {
+			const auto& g = k == 0 ? _g : _g_prev;
+			std::copy(g.begin(), g.begin() + systems(), dst);
+		};
+
+		virtual void internal_derivative(T* dst) const override {
+			std::copy(_dg.begin(), _dg.begin() + systems(), dst);
+		};
+
+		virtual void assign_internal(const T* src) override {
+			std::copy(src, src + systems(), _g.begin());
+		};
+
+		virtual void commit_internal(const T* src, const T* derivative) override {
+			_g_prev = _g;
+			std::copy(src, src + systems(), _g.begin());
+			std::copy(derivative, derivative + systems(), _dg.begin());
+		};
+
+		// packed state of the measure, resistances and resistances of the previous step
+		virtual size_t state_size() const override {
+			return StrainMeasure<T>::state_size() + 2 * systems();
+		};
+
+		virtual void write_state(T* dst) const override {
+			StrainMeasure<T>::write_state(dst);
+			dst += StrainMeasure<T>::state_size();
+			std::copy(_g.begin(), _g.begin() + systems(), dst);
+			std::copy(_g_prev.begin(), _g_prev.begin() + systems(), dst + systems());
+		};
+
+		virtual void read_state(const T* src) override {
+			StrainMeasure<T>::read_state(src);
+			_prepared = false;
+			src += StrainMeasure<T>::state_size();
+			std::copy(src, src + systems(), _g.begin());
+			std::copy(src + systems(), src + 2 * systems(), _g_prev.begin());
+		};
+	};
+
+	/*
+		Single crystal elasto-viscoplastic material, the basis of the point is the crystal lattice
+		CrystalPlasticity<StrainMeasure, StressMeasure>, params of slip systems are given by "slip" (see SlipParams)
+	*/
+	template<
+		template<class> class StrainMeasure,
+		template<class> class StressMeasure,
+		class T = double>
+	class CrystalPlasticity : public Elasticity<StrainMeasure, StressMeasure, T> {
+	protected:
+		std::shared_ptr<StrainMeasure<T>> F_in;
+		std::shared_ptr<StrainMeasure<T>> F_e;
+	public:
+		CrystalPlasticity(const json& params, measure::type_schema type) :
+			CrystalPlasticity(ModelParams<T>::parse(params), tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM), type)
+		{
+		};
+
+		CrystalPlasticity(const std::shared_ptr<const ModelParams<T>>& params, const Basis<T, 3>& basis, measure::type_schema type) :
+			Elasticity<StrainMeasure, StressMeasure, T>(params, basis, type)
+		{
+			if (!params->slip) {
+				throw std::invalid_argument("Param of crystal plasticity model 'slip' was not found");
+			}
+			F_in = std::make_shared<SlipRelation<StressMeasure, StrainMeasure, T>>(type, *this, this->S, params->slip);
+			F_e = std::make_shared<StrainDecomposition<StrainMeasure, T>>(type, *this, this->F, this->F_in);
+			this->reset_elastic_strain_measure(this->F_e); // change S(F) -> S(F_e)
+			this->register_measure(F_in);
+			this->register_measure(F_e);
+		};
+
+		const SlipRelation<StressMeasure, StrainMeasure, T>& slip() const {
+			return static_cast<const SlipRelation<StressMeasure, StrainMeasure, T>&>(*F_in);
+		}
+
+		SlipRelation<StressMeasure, StrainMeasure, T>& slip() {
+			return static_cast<SlipRelation<StressMeasure, StrainMeasure, T>&>(*F_in);
+		}
+
+		virtual void calc_loading(T dt) override {
+			this->F->calc(dt); // loading -> L / F
+		};
+
+		// rate dependent: every system slips at any stress
+		virtual activity classify(T dt) override {
+			return activity::PLASTIC;
+		};
+
+		virtual void calc_response(T dt) override {
+			this->F_in->calc(dt); // slip relation -> L_in / F_in
+			this->F_e->calc(dt);  // strain decomposition L_e / F_e
+			this->S->calc(dt);    // elastic relation -> S_rate / S
+		};
+
+		virtual std::ostream& print_measures(std::ostream& out) const override {
+			out << *this->F << std::endl;
+			out << *this->F_in << std::endl;
+			out << *this->F_e << std::endl;
+			out << *this->S << std::endl;
+			return out;
+		}
+	};
+
+	/*
+		Step of a block of at most BLOCK crystal grains with the same slip systems, sums over systems are vectorized across grains:
+			- init and loading of all grains
+			- stresses of grains are gathered component-major (component c of the grain k at c * count + k),
+			  resolved shear stresses of all grains are one batch kernel (slip::SchmidTensors)
+			- slip rates of each grain (own resistances), then L_in of all grains is one batch kernel
+			- response of each grain takes its L_in (see SlipRelation::take_velocity_gradient), finalize and time
+		buffers are allocated once, the result and statuses are the same as try_step of each grain
+	*/
+	template<typename T>
+	class SlipBatch {
+	public:
+		static constexpr size_t BLOCK = 32;
+	private:
+		alignas(64) std::array<T, slip::COMP * BLOCK> _S{};
+		alignas(64) std::array<T, slip::MAX_SYSTEMS * BLOCK> _tau{};
+		alignas(64) std::array<T, slip::MAX_SYSTEMS * BLOCK> _gamma{};
+		alignas(64) std::array<T, slip::COMP * BLOCK> _L{};
+		std::array<size_t, BLOCK> _ready{}; // grains with the calculated loading
+
+	public:
+		template<class Grain>
+		void step(const std::vector<std::shared_ptr<Grain>>& grains, size_t begin, size_t end, T dt, numerical_schema::step_status* status) {
+			using numerical_schema::step_status;
+			size_t count = 0;
+			for (size_t idx = begin; idx < std::min(end, begin + BLOCK); ++idx) {
+				auto& grain = *grains[idx];
+				status[idx] = grain.try_phases([&] {
+					grain.init();
+					grain.calc_loading(dt);
+				});
+				if (status[idx] == step_status::OK) _ready[count++] = idx;
+			}
+			if (count == 0) return;
+			for (size_t k = 0; k < count; ++k) {
+				const T* S = grains[_ready[k]]->stress()->value().data();
+				for (size_t c = 0; c < slip::COMP; ++c) _S[c * count + k] = S[c];
+			}
+			const auto& schmid = grains[_ready[0]]->slip().schmid_tensors();
+			schmid.resolved_shear(_S.data(), count, _tau.data());
+			for (size_t k = 0; k < count; ++k) {
+				grains[_ready[k]]->slip().take_resolved_shear(_tau.data() + k, count, _gamma.data() + k);
+			}
+			schmid.velocity_gradient(_gamma.data(), count, _L.data());
+			for (size_t k = 0; k < count; ++k) {
+				const size_t idx = _ready[k];
+				auto& grain = *grains[idx];
+				grain.slip().take_velocity_gradient(_L.data() + k, count);
+				status[idx] = grain.try_phases([&] {
+					grain.calc_response(dt);
+					grain.finalize();
+				});
+				if (status[idx] != step_status::OK) continue;
+				grain.inc_time(dt);
+				if (!grain.is_finite()) status[idx] = step_status::NOT_FINITE;
+			}
+		}
+	};
+};
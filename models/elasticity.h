@@ -17,6 +17,7 @@ namespace model {
 		template<typename T> class StressMeasure, typename T>
 	class Elasticity : public MaterialPoint<T, 3> {
 	protected:
+		std::shared_ptr<const ModelParams<T>> model_param;
 		std::array<T, 2> elast_modulus;
 		std::shared_ptr<StrainMeasure<T>> F;
 		std::shared_ptr<StressMeasure<T>> S;
@@ -25,18 +26,61 @@ namespace model {
 		}
 	public:
 		Elasticity(const json& params, measure::type_schema type) : 
-			MaterialPoint<T, 3>(params, type),
+			Elasticity(ModelParams<T>::parse(params), tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM), type)
+		{
+		};
+
+		// builds a point from already parsed and validated params (no file I/O, no parsing)
+		Elasticity(const std::shared_ptr<const ModelParams<T>>& params, const Basis<T, 3>& basis, measure::type_schema type) :
+			MaterialPoint<T, 3>(params->source, basis, type),
+			model_param(params),
 			F(std::make_shared<StrainMeasure<T>>(*this, type))
 		{
-			elast_modulus = parse_json_value<std::array<T, 2>>("elast_modulus", params);
-			S = std::make_shared<ElasticRelation<StressMeasure, StrainMeasure, T>>(type, *this, this->F, elast_modulus);
+			elast_modulus = params->elast_modulus;
+			if (params->anisotropy) {
+				S = std::make_shared<AnisotropicElasticRelation<StressMeasure, StrainMeasure, T>>(type, *this, this->F, elast_modulus, *params->anisotropy);
+			} else {
+				S = std::make_shared<ElasticRelation<StressMeasure, StrainMeasure, T>>(type, *this, this->F, elast_modulus);
+			}
+			this->register_measure(F);
+			this->register_measure(S);
 		};
 
-		virtual void calc(T dt) override {
+		const std::shared_ptr<const ModelParams<T>>& model_params() const {
+			return model_param;
+		}
+
+		const std::shared_ptr<StrainMeasure<T>>& strain() const {
+			return F;
+		}
+
+		const std::shared_ptr<StressMeasure<T>>& stress() const {
+			return S;
+		}
+
+		// phases of calc for a batch update (see BatchUpdate): loading, classification, response
+		virtual void calc_loading(T dt) {
 			F->calc(dt);
+		};
+
+		virtual activity classify(T dt) {
+			return activity::ELASTIC;
+		};
+
+		virtual void calc_response(T dt) {
 			S->calc(dt);
 		};
 
+		// response of a point classified elastic in the current step
+		virtual void calc_elastic_response(T dt) {
+			calc_response(dt);
+		};
+
+		virtual void calc(T dt) override {
+			calc_loading(dt);
+			calc_response(dt);
+		};
+
 		virtual std::ostream& print_measures(std::ostream& out) const override {
 			out << *F << std::endl; 
 			out << *S << std::endl;
@@ -47,23 +91,79 @@ namespace model {
 
 namespace measure {
 	namespace strain {
+		// loading of the deformation gradient (shared with the static pipeline, see static_model.h)
+		namespace loading {
+			template<typename T>
+			void rate(T t, tens::M3x3<T>& L) {
+				L.fill_value(tens::FILL_TYPE::ZERO);
+				L[0] = 2;
+				L[1] = -1;
+				L[2] = -1;
+			}
+
+			template<typename T>
+			void value(T t, tens::M3x3<T>& F) {
+				F.fill_value(tens::FILL_TYPE::ZERO);
+				F[0] = T(1) + t;
+				F[1] = F[2] = std::sqrt(T(1) / F[0]);
+			}
+
+			// the default loading as a path
+			template<typename T>
+			class Default : public Path<T> {
+			public:
+				virtual void rate(T t, tens::M3x3<T>& L) const override {
+					loading::rate(t, L);
+				}
+				virtual void value(T t, tens::M3x3<T>& F) const override {
+					loading::value(t, F);
+				}
+			};
+
+			// macroscopic path (at the lab basis) seen by a point with the basis B: X -> B.X.Bt
+			template<typename T>
+			class Rotated : public Path<T> {
+				std::shared_ptr<const Path<T>> _macro;
+				tens::M3x3<T> _basis;
+				mutable tens::M3x3<T> _temp; // the path is owned by one point
+
+				void rotate(tens::M3x3<T>& X) const {
+					math::dim3::mat_scal_mat(_basis.data(), X.data(), _temp.data());
+					math::dim3::mat_scal_mat_transp(_temp.data(), _basis.data(), X.data());
+				}
+			public:
+				Rotated(const std::shared_ptr<const Path<T>>& macro, const tens::M3x3<T>& basis) :
+					_macro(macro), _basis(basis), _temp(tens::FILL_TYPE::ZERO) {};
+
+				virtual void rate(T t, tens::M3x3<T>& L) const override {
+					_macro->rate(t, L);
+					rotate(L);
+				}
+				virtual void value(T t, tens::M3x3<T>& F) const override {
+					_macro->value(t, F);
+					rotate(F);
+				}
+			};
+		}
+
 		// assignment a new rate L
 		template<typename T>
 		void measure::strain::GradDeform<T>::rate_equation(T t, T dt) {
-			auto& L = this->rate_temp;
-			L.fill_value(tens::FILL_TYPE::ZERO);
-			L[0] = 2;
-			L[1] = -1;
-			L[2] = -1;
+			if (_path) {
+				_path->rate(t, this->rate_temp);
+			} else {
+				loading::rate(t, this->rate_temp);
+			}
 		}
 
 		// assignment a new value F 
 		template<typename T>
 		void measure::strain::GradDeform<T>::finite_equation(T t, T dt) {
-			auto& F = this->value_temp;
-			F.fill_value(tens::FILL_TYPE::ZERO);
-			F[0] = T(1) + t;
-			F[1] = F[2] = std::sqrt(T(1) / F[0]);
+			if (_path) {
+				_path->value(t, this->value_temp);
+			} else {
+				loading::value(t, this->value_temp);
+			}
 		}; 
 	};
 };
\ No newline at end of file
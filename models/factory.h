@@ -1,9 +1,14 @@
 #pragma once
+#include <thread>
+#include <vector>
 #include "../state-measure/state.h"
 #include "../tensor/object.h"
 #include "./relation.h"
 #include "./elasticity.h"
 #include "./plasticity.h"
+#include "./crystal_plasticity.h"
+#include "./helpers/param_binary.h"
+#include "./helpers/parallel.h"
 
 namespace model {
 	using namespace state;
@@ -12,37 +17,51 @@ namespace model {
 	template<
 		template<template<class> class, template<class> class, class> class Model>
 	class ModelFactory {
+		static json read_json(const std::string& param_json_file) {
+			json params;
+			std::ifstream filematerial(param_json_file);
+			std::string jsonString;
+
+			if (filematerial.is_open()) {
+				try {
+					jsonString = std::string((std::istreambuf_iterator<char>(filematerial)), std::istreambuf_iterator<char>());
+					try {
+						params = json::parse(jsonString);
+					} catch (const std::exception& e) {
+						throw std::ifstream::failure("Failed during parsing json: " + param_json_file + " \n Reason: " + std::string(e.what()));
+					}
+				} catch (const std::exception& e) {
+					filematerial.close();
+					throw std::ifstream::failure("Failed during reading file: " + param_json_file + " \n Reason: " + std::string(e.what()));
+				}
+			}
+			else {
+				throw std::ios_base::failure("Failed to open file: " + param_json_file);
+			}
+			return params;
+		}
+
 	public:
 		static void test() {};
 
+		// params from json or compiled binary file (format is detected by the file content)
+		template<class T = double>
+		static std::shared_ptr<const ModelParams<T>> read_params(const std::string& param_file) {
+			if (binary::is_binary(param_file)) {
+				return binary::ParamFile(param_file).params<T>();
+			}
+			return ModelParams<T>::parse(read_json(param_file));
+		}
+
 		template<
 			template<class T> class StrainMeasure,
 			template<class T> class StressMeasure,
 			class T = double>
 		static std::shared_ptr<Model<StrainMeasure, StressMeasure, T>> create(const std::string& param_json_file, measure::type_schema type) {
-			json params;
-			std::ifstream filematerial(param_json_file);
-			std::string jsonString;
-
 			try {
-				if (filematerial.is_open()) {
-					try {
-						jsonString = std::string((std::istreambuf_iterator<char>(filematerial)), std::istreambuf_iterator<char>());
-						try {
-							params = json::parse(jsonString);
-						} catch (const std::exception& e) {
-							throw std::ifstream::failure("Failed during parsing json: " + param_json_file + " \n Reason: " + std::string(e.what()));
-						}
-					} catch (const std::exception& e) {
-						filematerial.close();
-						throw std::ifstream::failure("Failed during reading file: " + param_json_file + " \n Reason: " + std::string(e.what()));
-					}
-				}
-				else {
-					throw std::ios_base::failure("Failed to open file: " + param_json_file);
-				}
+				const auto params = read_params<T>(param_json_file);
 				try {
-					auto result = std::make_shared<Model<StrainMeasure, StressMeasure, T>>(params, type);
+					auto result = std::make_shared<Model<StrainMeasure, StressMeasure, T>>(params, tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM), type);
 					return result;
 				} catch (const std::exception& e) {
 					throw std::runtime_error("Model creation was failed. Reason: " + std::string(e.what()));
@@ -52,5 +71,48 @@ namespace model {
 				exit(1);
 			}
 		}
+
+		// reads and validates params once, the result is a prototype for cheap clones
+		template<
+			template<class T> class StrainMeasure,
+			template<class T> class StressMeasure,
+			class T = double>
+		static std::shared_ptr<Model<StrainMeasure, StressMeasure, T>> prototype(const std::string& param_json_file, measure::type_schema type) {
+			return create<StrainMeasure, StressMeasure, T>(param_json_file, type);
+		}
+
+		// a new point sharing immutable params of the prototype, only state and orientation are own
+		template<
+			template<class T> class StrainMeasure,
+			template<class T> class StressMeasure,
+			class T>
+		static std::shared_ptr<Model<StrainMeasure, StressMeasure, T>> clone(const Model<StrainMeasure, StressMeasure, T>& prototype, const Basis<T, 3>& basis) {
+			return std::make_shared<Model<StrainMeasure, StressMeasure, T>>(prototype.model_params(), basis, prototype.numerical_schema_type());
+		}
+
+		template<
+			template<class T> class StrainMeasure,
+			template<class T> class StressMeasure,
+			class T>
+		static std::shared_ptr<Model<StrainMeasure, StressMeasure, T>> clone(const Model<StrainMeasure, StressMeasure, T>& prototype) {
+			return clone(prototype, tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM));
+		}
+
+		// count clones with random orientations created by threads in parallel
+		// orientation of the point i depends only on (seed, i), so the result does not depend on number of threads
+		template<
+			template<class T> class StrainMeasure,
+			template<class T> class StressMeasure,
+			class T>
+		static std::vector<std::shared_ptr<Model<StrainMeasure, StressMeasure, T>>> clone(const Model<StrainMeasure, StressMeasure, T>& prototype,
+			size_t count, size_t threads = std::thread::hardware_concurrency(), unsigned seed = std::random_device()()) {
+			std::vector<std::shared_ptr<Model<StrainMeasure, StressMeasure, T>>> points(count);
+			parallel(count, threads, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					points[i] = clone(prototype, random_basis<T>(seed, i));
+				}
+			});
+			return points;
+		}
 	};
-};
\ No newline at end of file
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <memory>
+#include <new>
+#include <vector>
+#include "./static_model.h"
+#include "./helpers/parallel.h"
+
+namespace model {
+	/*
+		Flat layout of a batch of points with the same params (static pipeline):
+			- hot data (value, rate, value_prev, rate_prev of all measures of all points) is one buffer aligned to the cache line,
+			  the block of a point is MEASURES_COUNT * MEASURE_SLOTS containers padded to the cache line
+			- cold data (params, elastic modules, curve, orientations) is kept once per batch or in separate arrays,
+			  the time is common for the batch
+			- measures of a point are views into its block (fixed::View), they are built for the step of the point
+		a point costs hot_bytes_per_point() + its basis instead of measure objects with own temporaries and links
+	*/
+	namespace flat {
+		template<template<class, class, template<class> class> class Measures, class Schema, typename T = double>
+		class Batch {
+		public:
+			using view_type = Measures<Schema, T, fixed::View>;
+			static constexpr size_t SLOTS = view_type::MEASURES_COUNT * fixed::MEASURE_SLOTS;
+			static constexpr size_t ALIGNMENT = 64;
+			static constexpr size_t STRIDE = (SLOTS * sizeof(tens::M3x3<T>) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; // bytes
+		private:
+			struct HotDeleter {
+				size_t count = 0;
+				void operator()(std::byte* hot) const {
+					for (size_t i = 0; i < count; ++i) {
+						std::destroy_n(reinterpret_cast<tens::M3x3<T>*>(hot + i * STRIDE), SLOTS);
+					}
+					::operator delete(hot, std::align_val_t(ALIGNMENT));
+				}
+			};
+
+			std::shared_ptr<const ModelParams<T>> _params;
+			ElasticModules<T> _c;
+			std::vector<Basis<T, 3>> _bases;
+			std::unique_ptr<std::byte, HotDeleter> _hot;
+			T _t = 0;
+
+		public:
+			Batch(const std::shared_ptr<const ModelParams<T>>& params, const std::vector<Basis<T, 3>>& bases) :
+				_params(params),
+				_c(params->elast_modulus[0], params->elast_modulus[1]),
+				_bases(bases)
+			{
+				view_type::validate(*params);
+				const size_t count = bases.size();
+				auto hot = static_cast<std::byte*>(::operator new(std::max<size_t>(1, count * STRIDE), std::align_val_t(ALIGNMENT)));
+				_hot = std::unique_ptr<std::byte, HotDeleter>(hot, HotDeleter{ 0 });
+				for (size_t i = 0; i < count; ++i) {
+					std::uninitialized_default_construct_n(reinterpret_cast<tens::M3x3<T>*>(hot + i * STRIDE), SLOTS);
+					_hot.get_deleter().count++;
+					point(i).reset();
+				}
+			};
+
+			// count points with random orientations, the orientation of the point i depends only on (seed, i)
+			Batch(const std::shared_ptr<const ModelParams<T>>& params, size_t count, unsigned seed) :
+				Batch(params, random_bases<T>(count, seed)) {};
+
+			Batch(const Batch&) = delete;
+			Batch& operator= (const Batch&) = delete;
+
+			static constexpr size_t hot_bytes_per_point() { return STRIDE; };
+			static constexpr measure::type_schema numerical_schema_type() { return Schema::type; };
+
+			size_t size() const { return _bases.size(); };
+			T t() const { return _t; };
+			const std::shared_ptr<const ModelParams<T>>& model_params() const { return _params; };
+			const Basis<T, 3>& basis(size_t idx) const { return _bases[idx]; };
+
+			// containers of the point: measure m, slot s (value, rate, value_prev, rate_prev) at [m * MEASURE_SLOTS + s]
+			tens::M3x3<T>* hot(size_t idx) {
+				return reinterpret_cast<tens::M3x3<T>*>(_hot.get() + idx * STRIDE);
+			};
+
+			// measures of the point as views into its block
+			view_type point(size_t idx) {
+				return view_type(*_params, _c, _t, hot(idx));
+			};
+
+			void calc(T dt, size_t begin, size_t end) {
+				for (size_t idx = begin; idx < end; ++idx) {
+					point(idx).calc(dt);
+				}
+			};
+
+			// step of all points, contiguous ranges of points per thread
+			void step(T dt, size_t threads = 1) {
+				parallel(size(), threads, [&](size_t begin, size_t end) {
+					calc(dt, begin, end);
+				});
+				_t += dt;
+			};
+		};
+
+		template<class Schema, typename T = double>
+		using Elasticity = Batch<fixed::ElasticityMeasures, Schema, T>;
+
+		template<class Schema, typename T = double>
+		using Plasticity = Batch<fixed::PlasticityMeasures, Schema, T>;
+	}
+}
@@ -1,29 +1,47 @@
 #pragma once
 #include "../../state-measure/state.h"
 #include "../relation.h"
+#include <span>
 
 namespace model {
 	template<class T>
 	T parse_json_value(const std::string& name, const json& params) {
 		try {
-			return params[name].get<T>();
+			return params.at(name).get<T>();
 		}
 		catch (const std::exception& e) {
 			throw std::invalid_argument("Param of plastic model '" + name + "' was not found or has wrong format. Reason " + std::string(e.what()));
 		}
 	};
 
+	// piecewise linear curve, points are owned by the curve or viewed in external storage (e.g. mapped file)
 	template<typename T>
-	class Curve : public std::vector<std::pair<T, T>> {
+	class Curve {
 	private:
+		std::shared_ptr<const void> _owner; // keeps storage of the points alive
+		std::span<const std::pair<T, T>> _points;
+
+		void validate() const {
+			if (_points.size() <= 1) {
+				throw std::invalid_argument("Curve plasticity: array must contain at least to points");
+			}
+
+			for (std::size_t i = 1; i < _points.size(); ++i) {
+				if (_points[i].first < _points[i - 1].first) {
+					throw std::invalid_argument("Curve plasticity: array must be monotonously increasing by the first component");
+				}
+			}
+		}
+
 		size_t search_lower_bound(T value) const {
+			TENS_PROFILE_SCOPE(CURVE_LOOKUP);
 			const auto it_begin = this->begin();
 			const auto it_end = this->end();
 			auto it_last = it_end - 1;
 			if (value < it_begin->first || value > it_last->first) {
-				throw std::out_of_range("Curve plasticity out of range. Value = " + std::to_string(value));
+				throw std::out_of_range("Curve plasticity out of range. Value = " + std::to_string(ad::value(value)));
 			}
-			auto iter = std::lower_bound(it_begin, it_end, std::make_pair(value, 0.0),
+			auto iter = std::lower_bound(it_begin, it_end, std::make_pair(value, T(0)),
 				[](const std::pair<T, T>& a, const std::pair<T, T>& b) {
 				return a.first < b.first;
 			});
@@ -32,21 +50,38 @@ namespace model {
 			return std::distance(it_begin, iter);
 		}
 	public:
-		Curve(const std::vector<std::pair<T, T>>& arr) :
-			std::vector<std::pair<T, T>>(arr) {
-			if (arr.size() <= 1) {
-				throw std::invalid_argument("Curve plasticity: array must contain at least to points");
-			}
+		template<typename X>
+		using result_type = std::conditional_t<ad::is_dual_v<X>, X, T>;
 
-			for (std::size_t i = 1; i < arr.size(); ++i) {
-				if (arr[i].first < arr[i - 1].first) {
-					throw std::invalid_argument("Curve plasticity: array must be monotonously increasing by the first component");
-				}
-			}
+		Curve(const std::vector<std::pair<T, T>>& arr) {
+			const auto storage = std::make_shared<const std::vector<std::pair<T, T>>>(arr);
+			_points = std::span<const std::pair<T, T>>(storage->data(), storage->size());
+			_owner = storage;
+			validate();
 		}
 
-		T value(T x) const {
-			const size_t pos = search_lower_bound(x); // return pos = [0, last]
+		// view of points without copying, owner keeps the storage alive
+		Curve(std::span<const std::pair<T, T>> points, std::shared_ptr<const void> owner) :
+			_owner(std::move(owner)),
+			_points(points) {
+			validate();
+		}
+
+		size_t size() const { return _points.size(); };
+		auto begin() const { return _points.begin(); };
+		auto end() const { return _points.end(); };
+		const std::pair<T, T>& operator[] (size_t idx) const { return _points[idx]; };
+
+		// x may be a dual number (forward mode AD), then the result carries the slope of the segment
+		template<typename X>
+		result_type<X> value(const X& x) const {
+			const size_t pos = search_lower_bound(T(ad::value(x))); // return pos = [0, last]
+			return segment_value(pos, x);
+		}
+
+		// y on the segment [pos - 1, pos] at x
+		template<typename X>
+		result_type<X> segment_value(size_t pos, const X& x) const {
 			T x_r = (*this)[pos].first;
 			T x_l = (*this)[pos - 1].first;
 			T y_r = (*this)[pos].second;
@@ -55,6 +90,28 @@ namespace model {
 			return y_l + (y_r - y_l) * (x - x_l) / (x_r - x_l);
 		}
 
+		// exact integral of the piecewise linear curve over [x0, x1]
+		T integral(T x0, T x1) const {
+			if (x1 < x0) return -integral(x1, x0);
+			search_lower_bound(x1); // range check
+			size_t pos = search_lower_bound(x0);
+			T result = 0;
+			T x = x0;
+			while (true) {
+				const T x_r = std::min(x1, (*this)[pos].first);
+				result += (x_r - x) * (segment_value(pos, x) + segment_value(pos, x_r)) / 2;
+				if (x_r >= x1 || pos + 1 == size()) break;
+				x = x_r;
+				++pos;
+			}
+			return result;
+		}
+
+		// mean value over [x0, x1]
+		T mean(T x0, T x1) const {
+			return x1 == x0 ? value(x1) : integral(x0, x1) / (x1 - x0);
+		}
+
 		T derivative(T x) const {
 			const size_t pos = search_lower_bound(x); // return pos = [0, last]
 			T x_r = (*this)[pos].first;
@@ -65,4 +122,136 @@ namespace model {
 			return (y_r - y_l) / (x_r - x_l);
 		}
 	};
-}
\ No newline at end of file
+
+	// settings of the implicit (elastic predictor / plastic corrector) mode of plastic relation
+	template<typename T>
+	struct ReturnMappingParams {
+		bool enabled = false;
+		T tolerance = T(1e-10);     // relative residual of the consistency condition
+		size_t max_iterations = 20; // of the local Newton solve
+
+		static ReturnMappingParams parse(const json& params) {
+			ReturnMappingParams result;
+			result.enabled = params.contains("enabled") ? parse_json_value<bool>("enabled", params) : true;
+			if (params.contains("tolerance")) result.tolerance = parse_json_value<T>("tolerance", params);
+			if (params.contains("max_iterations")) result.max_iterations = parse_json_value<size_t>("max_iterations", params);
+			return result;
+		}
+	};
+
+	// slip systems of the crystal plasticity model: power-law slip rates, hardening of critical resolved shear stresses
+	template<typename T>
+	struct SlipParams {
+		size_t systems = 12;                 // 12 (fcc {111}<110>), 24 (bcc {110}<111> + {112}<111>), 48 (+ bcc {123}<111>)
+		T reference_rate = T(1e-3);          // gamma0
+		T rate_sensitivity = T(0.05);        // m, gamma_a = gamma0 * |tau_a / g_a|^(1/m) * sign(tau_a)
+		T initial_resistance = T(60);        // g_a(0)
+		T hardening_modulus = T(200);        // h0
+		T saturation_resistance = T(150);    // g_sat, h_b = h0 * (1 - g_b / g_sat)^a
+		T hardening_exponent = T(2);         // a
+		T latent_ratio = T(1.4);             // q, h_ab = h_b * (q + (1 - q) * delta_ab)
+
+		static SlipParams parse(const json& params) {
+			SlipParams result;
+			if (params.contains("systems")) result.systems = parse_json_value<size_t>("systems", params);
+			if (params.contains("reference_rate")) result.reference_rate = parse_json_value<T>("reference_rate", params);
+			if (params.contains("rate_sensitivity")) result.rate_sensitivity = parse_json_value<T>("rate_sensitivity", params);
+			if (params.contains("initial_resistance")) result.initial_resistance = parse_json_value<T>("initial_resistance", params);
+			if (params.contains("hardening_modulus")) result.hardening_modulus = parse_json_value<T>("hardening_modulus", params);
+			if (params.contains("saturation_resistance")) result.saturation_resistance = parse_json_value<T>("saturation_resistance", params);
+			if (params.contains("hardening_exponent")) result.hardening_exponent = parse_json_value<T>("hardening_exponent", params);
+			if (params.contains("latent_ratio")) result.latent_ratio = parse_json_value<T>("latent_ratio", params);
+			if (result.systems != 12 && result.systems != 24 && result.systems != 48) {
+				throw std::invalid_argument("Param of plastic model 'systems' must be 12, 24 or 48");
+			}
+			if (!(result.rate_sensitivity > T(0)) || !(result.initial_resistance > T(0))) {
+				throw std::invalid_argument("Param of plastic model 'rate_sensitivity' and 'initial_resistance' must be positive");
+			}
+			return result;
+		}
+	};
+
+	/*
+		anisotropic elastic constants at the material axes, Voigt notation (11, 22, 33, 23, 13, 12):
+			- "cubic": C11, C12, C44
+			- "transversely_isotropic" (the axis 3 is the axis of symmetry): C11, C12, C13, C33, C44
+			- "orthotropic": C11, C22, C33, C12, C13, C23, C44, C55, C66
+	*/
+	template<typename T>
+	struct AnisotropyParams {
+		std::string symmetry;
+		std::array<T, 36> voigt{ T(0) }; // 6x6 stiffness, row by row
+
+		T& operator()(size_t I, size_t J) { return voigt[(I - 1) * 6 + (J - 1)]; };
+		T operator()(size_t I, size_t J) const { return voigt[(I - 1) * 6 + (J - 1)]; };
+
+		static AnisotropyParams parse(const json& params) {
+			AnisotropyParams result;
+			result.symmetry = parse_json_value<std::string>("symmetry", params);
+			const auto C = [&params](const std::string& name) { return parse_json_value<T>(name, params); };
+			auto& c = result;
+			if (result.symmetry == "cubic") {
+				c(1, 1) = c(2, 2) = c(3, 3) = C("C11");
+				c(1, 2) = c(1, 3) = c(2, 3) = C("C12");
+				c(4, 4) = c(5, 5) = c(6, 6) = C("C44");
+			} else if (result.symmetry == "transversely_isotropic") {
+				c(1, 1) = c(2, 2) = C("C11");
+				c(3, 3) = C("C33");
+				c(1, 2) = C("C12");
+				c(1, 3) = c(2, 3) = C("C13");
+				c(4, 4) = c(5, 5) = C("C44");
+				c(6, 6) = (c(1, 1) - c(1, 2)) / 2;
+			} else if (result.symmetry == "orthotropic") {
+				c(1, 1) = C("C11"); c(2, 2) = C("C22"); c(3, 3) = C("C33");
+				c(1, 2) = C("C12"); c(1, 3) = C("C13"); c(2, 3) = C("C23");
+				c(4, 4) = C("C44"); c(5, 5) = C("C55"); c(6, 6) = C("C66");
+			} else {
+				throw std::invalid_argument("Param of elastic model 'symmetry' must be cubic, transversely_isotropic or orthotropic");
+			}
+			c(2, 1) = c(1, 2);
+			c(3, 1) = c(1, 3);
+			c(3, 2) = c(2, 3);
+			for (size_t I = 1; I <= 6; ++I) {
+				if (!(c(I, I) > T(0))) {
+					throw std::invalid_argument("Param of elastic model 'anisotropy': diagonal constants must be positive");
+				}
+			}
+			return result;
+		}
+	};
+
+	/*
+		Immutable parameters of a model (flyweight): parsed and validated once,
+		shared by the prototype and all its clones
+	*/
+	template<typename T>
+	struct ModelParams {
+		std::shared_ptr<const json> source;
+		std::array<T, 2> elast_modulus{ T(0) };
+		std::shared_ptr<const Curve<T>> curve; // empty for pure elastic parameters
+		T flow_treshold = T(0);
+		ReturnMappingParams<T> return_mapping; // optional "return_mapping": { "tolerance", "max_iterations" }
+		std::shared_ptr<const SlipParams<T>> slip; // optional "slip" of the crystal plasticity model
+		std::shared_ptr<const AnisotropyParams<T>> anisotropy; // optional "anisotropy" of the elastic relation
+
+		static std::shared_ptr<const ModelParams<T>> parse(const json& params) {
+			auto result = std::make_shared<ModelParams<T>>();
+			result->source = std::make_shared<const json>(params);
+			result->elast_modulus = parse_json_value<std::array<T, 2>>("elast_modulus", params);
+			if (params.contains("curve")) {
+				result->curve = std::make_shared<const Curve<T>>(parse_json_value<std::vector<std::pair<T, T>>>("curve", params));
+				result->flow_treshold = parse_json_value<T>("flow_treshold", params);
+			}
+			if (params.contains("return_mapping")) {
+				result->return_mapping = ReturnMappingParams<T>::parse(params["return_mapping"]);
+			}
+			if (params.contains("slip")) {
+				result->slip = std::make_shared<const SlipParams<T>>(SlipParams<T>::parse(params["slip"]));
+			}
+			if (params.contains("anisotropy")) {
+				result->anisotropy = std::make_shared<const AnisotropyParams<T>>(AnisotropyParams<T>::parse(params["anisotropy"]));
+			}
+			return result;
+		}
+	};
+}
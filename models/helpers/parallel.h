@@ -0,0 +1,66 @@
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "../../tensor/object.h"
+
+namespace model {
+	// number of threads for count items: at least one, at most one per item
+	inline size_t thread_count(size_t count, size_t threads) {
+		return std::max<size_t>(1, std::min(threads, count));
+	}
+
+	/*
+		Runs task over contiguous ranges [begin, end) of count items, a range per thread
+		(task(begin, end) or task(begin, end, thread_idx)), the first range runs in the calling thread,
+		exceptions of ranges are rethrown after all threads are joined
+	*/
+	template<class Task>
+	void parallel(size_t count, size_t threads, const Task& task) {
+		threads = thread_count(count, threads);
+		std::vector<std::exception_ptr> errors(threads);
+		const auto worker = [&](size_t thread_idx) {
+			try {
+				const size_t begin = thread_idx * count / threads;
+				const size_t end = (thread_idx + 1) * count / threads;
+				if constexpr (std::is_invocable_v<const Task&, size_t, size_t, size_t>) {
+					task(begin, end, thread_idx);
+				} else {
+					task(begin, end);
+				}
+			} catch (...) {
+				errors[thread_idx] = std::current_exception();
+			}
+		};
+		std::vector<std::thread> pool;
+		for (size_t thread_idx = 1; thread_idx < threads; ++thread_idx) {
+			pool.emplace_back(worker, thread_idx);
+		}
+		worker(0);
+		for (auto& thread : pool) {
+			thread.join();
+		}
+		for (const auto& error : errors) {
+			if (error) std::rethrow_exception(error);
+		}
+	}
+
+	// random orientation of the point idx, depends only on (seed, idx), so results do not depend on threads
+	template<typename T>
+	Basis<T, 3> random_basis(unsigned seed, size_t idx) {
+		std::mt19937 engine(seed + static_cast<unsigned>(idx));
+		return tens::create_basis<T, 3>(tens::generate_rand_ort(engine));
+	}
+
+	template<typename T>
+	std::vector<Basis<T, 3>> random_bases(size_t count, unsigned seed) {
+		std::vector<Basis<T, 3>> bases(count);
+		for (size_t i = 0; i < count; ++i) {
+			bases[i] = random_basis<T>(seed, i);
+		}
+		return bases;
+	}
+}
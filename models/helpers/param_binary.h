@@ -0,0 +1,300 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include "../../state-measure/mapped_file.h"
+#include "../../state-measure/shared_memory.h"
+#include "./model_utils.h"
+
+namespace model {
+	/*
+		Compiled binary format of model params (alternative to json)
+		layout (native endianness):
+			Header                     - scalars and optional sections (return_mapping, slip, anisotropy)
+			CurveEntry[curve_count]    - offsets and sizes of curves
+			curve points               - pairs (x, y) of double, 16 bytes aligned
+		curve 0 is "curve" of json, next ones are items of optional "curves" (e.g. grain specific curves)
+	*/
+	namespace binary {
+		constexpr char MAGIC[4] = { 'T', 'M', 'P', 'B' };
+		constexpr uint32_t VERSION = 2;
+
+		// optional sections present in the header
+		enum section : uint32_t {
+			RETURN_MAPPING = 1,
+			SLIP = 2,
+			ANISOTROPY = 4
+		};
+
+		struct ReturnMappingSection {
+			uint32_t enabled;
+			uint32_t max_iterations;
+			double tolerance;
+		};
+
+		struct SlipSection {
+			uint64_t systems;
+			double reference_rate;
+			double rate_sensitivity;
+			double initial_resistance;
+			double hardening_modulus;
+			double saturation_resistance;
+			double hardening_exponent;
+			double latent_ratio;
+		};
+
+		// orthotropic constants describe all symmetries: C11, C22, C33, C12, C13, C23, C44, C55, C66
+		struct AnisotropySection {
+			char symmetry[32];
+			double constants[9];
+		};
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t scalar_size;   // sizeof(double)
+			uint32_t curve_count;
+			double density;
+			double elast_modulus[2];
+			double flow_treshold;
+			uint64_t file_size;
+			uint32_t sections;      // mask of section
+			uint32_t reserved;
+			ReturnMappingSection return_mapping;
+			SlipSection slip;
+			AnisotropySection anisotropy;
+		};
+
+		struct CurveEntry {
+			uint64_t offset; // in bytes from the beginning of the file
+			uint64_t size;   // number of points
+		};
+
+		static_assert(sizeof(std::pair<double, double>) == 2 * sizeof(double), "curve points must be packed pairs");
+
+		namespace error {
+			class WrongFormat : public std::exception {
+				std::string _msg;
+			public:
+				WrongFormat(const std::string& path, const std::string& reason) :
+					_msg("Wrong binary params file: " + path + " \n Reason: " + reason) {};
+				virtual const char* what() const noexcept {
+					return _msg.c_str();
+				};
+			};
+		}
+
+		inline size_t align(size_t offset, size_t alignment = 16) {
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+
+		// true if file starts with magic of binary params
+		inline bool is_binary(const std::string& file) {
+			std::ifstream stream(file, std::ios::binary);
+			char magic[4] = { 0 };
+			stream.read(magic, sizeof(magic));
+			return stream.gcount() == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(magic)) == 0;
+		}
+
+		// (I, J) of the Voigt matrix of constants of AnisotropySection
+		constexpr size_t ANISOTROPY_CONSTANTS[9][2] = { { 1, 1 }, { 2, 2 }, { 3, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 }, { 4, 4 }, { 5, 5 }, { 6, 6 } };
+		constexpr const char* ANISOTROPY_NAMES[9] = { "C11", "C22", "C33", "C12", "C13", "C23", "C44", "C55", "C66" };
+
+		/*
+			json -> image of binary params, all curves and sections are validated by parsers of json params,
+			so a binary file gives the same model as its json
+		*/
+		inline std::vector<char> compile(const json& params) {
+			std::vector<Curve<double>> curves;
+			if (params.contains("curve")) {
+				curves.emplace_back(parse_json_value<std::vector<std::pair<double, double>>>("curve", params));
+			}
+			if (params.contains("curves")) {
+				for (const auto& curve : parse_json_value<std::vector<std::vector<std::pair<double, double>>>>("curves", params)) {
+					curves.emplace_back(curve);
+				}
+			}
+
+			Header header{};
+			std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+			header.version = VERSION;
+			header.scalar_size = sizeof(double);
+			header.curve_count = static_cast<uint32_t>(curves.size());
+			header.density = params.contains("density") ? parse_json_value<double>("density", params) : 0.0;
+			const auto elast_modulus = parse_json_value<std::array<double, 2>>("elast_modulus", params);
+			header.elast_modulus[0] = elast_modulus[0];
+			header.elast_modulus[1] = elast_modulus[1];
+			// the same rule as ModelParams::parse: a curve requires the flow treshold
+			header.flow_treshold = curves.empty() ? 0.0 : parse_json_value<double>("flow_treshold", params);
+			if (params.contains("return_mapping")) {
+				const auto return_mapping = ReturnMappingParams<double>::parse(params["return_mapping"]);
+				header.sections |= RETURN_MAPPING;
+				header.return_mapping.enabled = return_mapping.enabled;
+				header.return_mapping.max_iterations = static_cast<uint32_t>(return_mapping.max_iterations);
+				header.return_mapping.tolerance = return_mapping.tolerance;
+			}
+			if (params.contains("slip")) {
+				const auto slip = SlipParams<double>::parse(params["slip"]);
+				header.sections |= SLIP;
+				header.slip = { slip.systems, slip.reference_rate, slip.rate_sensitivity, slip.initial_resistance,
+					slip.hardening_modulus, slip.saturation_resistance, slip.hardening_exponent, slip.latent_ratio };
+			}
+			if (params.contains("anisotropy")) {
+				const auto anisotropy = AnisotropyParams<double>::parse(params["anisotropy"]);
+				header.sections |= ANISOTROPY;
+				std::strncpy(header.anisotropy.symmetry, anisotropy.symmetry.c_str(), sizeof(header.anisotropy.symmetry) - 1);
+				for (size_t k = 0; k < 9; ++k) {
+					header.anisotropy.constants[k] = anisotropy(ANISOTROPY_CONSTANTS[k][0], ANISOTROPY_CONSTANTS[k][1]);
+				}
+			}
+
+			std::vector<CurveEntry> entries(curves.size());
+			size_t offset = align(sizeof(Header) + entries.size() * sizeof(CurveEntry));
+			for (size_t i = 0; i < curves.size(); ++i) {
+				entries[i].offset = offset;
+				entries[i].size = curves[i].size();
+				offset = align(offset + curves[i].size() * sizeof(std::pair<double, double>));
+			}
+			header.file_size = offset;
+
+			std::vector<char> image(offset, 0);
+			std::memcpy(image.data(), &header, sizeof(Header));
+			std::memcpy(image.data() + sizeof(Header), entries.data(), entries.size() * sizeof(CurveEntry));
+			for (size_t i = 0; i < curves.size(); ++i) {
+				std::memcpy(image.data() + entries[i].offset, &curves[i][0], entries[i].size * sizeof(std::pair<double, double>));
+			}
+			return image;
+		}
+
+		// json -> binary file
+		inline void convert(const json& params, const std::string& bin_file) {
+			const auto image = compile(params);
+			std::ofstream stream(bin_file, std::ios::binary | std::ios::trunc);
+			if (!stream.is_open()) {
+				throw std::ios_base::failure("Failed to open file: " + bin_file);
+			}
+			stream.write(image.data(), image.size());
+		}
+
+		inline void convert(const std::string& json_file, const std::string& bin_file) {
+			std::ifstream stream(json_file);
+			if (!stream.is_open()) {
+				throw std::ios_base::failure("Failed to open file: " + json_file);
+			}
+			convert(json::parse(stream), bin_file);
+		}
+
+		/*
+			Memory-mapped binary params (file or shared memory segment), curves are views into the mapping (no copying)
+			the mapping lives while any curve or params created from it is alive
+		*/
+		class ParamFile {
+			std::shared_ptr<const void> _owner;
+			const char* _data;
+			const Header* _header;
+			const CurveEntry* _entries;
+
+			// size may exceed file_size (segments are rounded up to pages on Windows)
+			void _validate(size_t size, const std::string& path, bool exact_size) {
+				if (size < sizeof(Header)) {
+					throw error::WrongFormat(path, "file is too small");
+				}
+				_header = reinterpret_cast<const Header*>(_data);
+				if (std::memcmp(_header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+					throw error::WrongFormat(path, "wrong magic");
+				}
+				if (_header->version != VERSION) {
+					throw error::WrongFormat(path, "unsupported version " + std::to_string(_header->version));
+				}
+				if (_header->scalar_size != sizeof(double) || (exact_size ? _header->file_size != size : _header->file_size > size)) {
+					throw error::WrongFormat(path, "wrong size");
+				}
+				const uint64_t file_size = _header->file_size;
+				if (file_size < sizeof(Header) || curve_count() > (file_size - sizeof(Header)) / sizeof(CurveEntry)) {
+					throw error::WrongFormat(path, "curve table is out of file");
+				}
+				_entries = reinterpret_cast<const CurveEntry*>(_data + sizeof(Header));
+				// no overflow: offset <= file_size is checked before the size of points
+				for (size_t i = 0; i < curve_count(); ++i) {
+					const auto& entry = _entries[i];
+					if (entry.offset > file_size || entry.offset % alignof(double) != 0
+						|| entry.size > (file_size - entry.offset) / sizeof(std::pair<double, double>)) {
+						throw error::WrongFormat(path, "curve " + std::to_string(i) + " is out of file");
+					}
+				}
+			}
+
+		public:
+			explicit ParamFile(const std::string& path) {
+				const auto file = std::make_shared<const io::MappedFile>(path);
+				_owner = file;
+				_data = file->data();
+				_validate(file->size(), path, true);
+			}
+
+			// params placed into shared memory by compile()
+			explicit ParamFile(const std::shared_ptr<const io::SharedMemory>& memory) :
+				_owner(memory),
+				_data(memory->data())
+			{
+				_validate(memory->size(), memory->name(), false);
+			}
+
+			const Header& header() const { return *_header; };
+			size_t curve_count() const { return _header->curve_count; };
+
+			template<typename T>
+			Curve<T> curve(size_t idx) const {
+				if (idx >= curve_count()) {
+					throw std::out_of_range("Binary params: curve " + std::to_string(idx) + " is not exists");
+				}
+				const auto points = reinterpret_cast<const std::pair<double, double>*>(_data + _entries[idx].offset);
+				if constexpr (std::is_same_v<T, double>) {
+					return Curve<T>(std::span<const std::pair<T, T>>(points, _entries[idx].size), _owner);
+				} else {
+					std::vector<std::pair<T, T>> arr(points, points + _entries[idx].size);
+					return Curve<T>(arr);
+				}
+			}
+
+			// params of a model with the curve idx (e.g. params of a grain), sections are rebuilt by parsers of json params
+			template<typename T>
+			std::shared_ptr<const ModelParams<T>> params(size_t curve_idx = 0) const {
+				auto result = std::make_shared<ModelParams<T>>();
+				json source;
+				source["density"] = _header->density;
+				source["elast_modulus"] = { _header->elast_modulus[0], _header->elast_modulus[1] };
+				result->elast_modulus = { T(_header->elast_modulus[0]), T(_header->elast_modulus[1]) };
+				if (curve_idx < curve_count()) {
+					source["flow_treshold"] = _header->flow_treshold;
+					result->curve = std::make_shared<const Curve<T>>(curve<T>(curve_idx));
+					result->flow_treshold = T(_header->flow_treshold);
+				}
+				if (_header->sections & RETURN_MAPPING) {
+					const auto& section = _header->return_mapping;
+					source["return_mapping"] = { { "enabled", section.enabled != 0 }, { "tolerance", section.tolerance }, { "max_iterations", section.max_iterations } };
+					result->return_mapping = ReturnMappingParams<T>::parse(source["return_mapping"]);
+				}
+				if (_header->sections & SLIP) {
+					const auto& section = _header->slip;
+					source["slip"] = { { "systems", section.systems }, { "reference_rate", section.reference_rate },
+						{ "rate_sensitivity", section.rate_sensitivity }, { "initial_resistance", section.initial_resistance },
+						{ "hardening_modulus", section.hardening_modulus }, { "saturation_resistance", section.saturation_resistance },
+						{ "hardening_exponent", section.hardening_exponent }, { "latent_ratio", section.latent_ratio } };
+					result->slip = std::make_shared<const SlipParams<T>>(SlipParams<T>::parse(source["slip"]));
+				}
+				if (_header->sections & ANISOTROPY) {
+					const auto& section = _header->anisotropy;
+					json anisotropy = { { "symmetry", std::string(section.symmetry, strnlen(section.symmetry, sizeof(section.symmetry))) } };
+					for (size_t k = 0; k < 9; ++k) {
+						anisotropy[ANISOTROPY_NAMES[k]] = section.constants[k];
+					}
+					source["anisotropy"] = anisotropy;
+					result->anisotropy = std::make_shared<const AnisotropyParams<T>>(AnisotropyParams<T>::parse(anisotropy));
+				}
+				result->source = std::make_shared<const json>(std::move(source));
+				return result;
+			}
+		};
+	};
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "../../tensor/container.h"
+
+namespace model {
+	namespace slip {
+		constexpr size_t MAX_SYSTEMS = 48;
+		constexpr size_t COMP = 9;
+		// (i, j) of the container component c, layout { 00, 11, 22, 12, 02, 01, 21, 20, 10 }
+		constexpr size_t ROW[COMP] = { 0, 1, 2, 1, 0, 0, 2, 2, 1 };
+		constexpr size_t COL[COMP] = { 0, 1, 2, 2, 2, 1, 1, 0, 0 };
+
+		/*
+			Schmid tensors P_a = d_a x n_a of slip systems at the crystal basis (the basis of the point)
+			stored as structure of arrays: component c of all systems is contiguous (_p[c][a]),
+			so sums over systems and over grains are plain loops over contiguous arrays (vectorized by the compiler)
+				- resolved shear stresses tau_a = S : P_a
+				- plastic velocity gradient L_p = sum_a gamma_a * P_a
+		*/
+		template<typename T>
+		class SchmidTensors {
+			size_t _count = 0;
+			alignas(64) std::array<std::array<T, MAX_SYSTEMS>, COMP> _p{};
+
+			using vec = std::array<int, 3>;
+
+			// all vectors of the family {a b c} (permutations and signs), a vector and its negative are the same
+			static std::vector<vec> family(vec v) {
+				std::vector<vec> res;
+				std::sort(v.begin(), v.end());
+				do {
+					for (int signs = 0; signs < 8; ++signs) {
+						vec u = { signs & 1 ? -v[0] : v[0], signs & 2 ? -v[1] : v[1], signs & 4 ? -v[2] : v[2] };
+						const auto first = std::find_if(u.begin(), u.end(), [](int x) { return x != 0; });
+						if (*first < 0) continue;
+						if (std::find(res.begin(), res.end(), u) == res.end()) res.push_back(u);
+					}
+				} while (std::next_permutation(v.begin(), v.end()));
+				return res;
+			}
+
+			void add_family(const vec& plane, const vec& direction) {
+				for (const auto& n : family(plane)) {
+					for (const auto& d : family(direction)) {
+						if (n[0] * d[0] + n[1] * d[1] + n[2] * d[2] != 0) continue;
+						const T n_norm = std::sqrt(T(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]));
+						const T d_norm = std::sqrt(T(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+						for (size_t c = 0; c < COMP; ++c) {
+							_p[c][_count] = T(d[ROW[c]]) * T(n[COL[c]]) / (n_norm * d_norm);
+						}
+						_count++;
+					}
+				}
+			}
+
+			explicit SchmidTensors(size_t systems) {
+				if (systems == 12) {
+					add_family({ 1, 1, 1 }, { 1, 1, 0 });
+				} else {
+					add_family({ 1, 1, 0 }, { 1, 1, 1 });
+					add_family({ 1, 1, 2 }, { 1, 1, 1 });
+					if (systems == 48) add_family({ 1, 2, 3 }, { 1, 1, 1 });
+				}
+				if (_count != systems) {
+					throw std::invalid_argument("Slip systems: " + std::to_string(systems) + " systems are not supported");
+				}
+			}
+
+		public:
+			// immutable tensors of 12, 24 or 48 systems shared by all points
+			static std::shared_ptr<const SchmidTensors> of(size_t systems) {
+				static const auto fcc = std::shared_ptr<const SchmidTensors>(new SchmidTensors(12));
+				static const auto bcc = std::shared_ptr<const SchmidTensors>(new SchmidTensors(24));
+				static const auto bcc48 = std::shared_ptr<const SchmidTensors>(new SchmidTensors(48));
+				switch (systems) {
+				case 12: return fcc;
+				case 24: return bcc;
+				case 48: return bcc48;
+				default: throw std::invalid_argument("Slip systems: " + std::to_string(systems) + " systems are not supported");
+				}
+			}
+
+			size_t size() const { return _count; };
+
+			// component c of the Schmid tensor of the system a
+			T operator()(size_t a, size_t c) const { return _p[c][a]; };
+
+			// tau[a] = S : P_a for all systems
+			void resolved_shear(const T* S, T* tau) const {
+				for (size_t a = 0; a < _count; ++a) tau[a] = T(0);
+				for (size_t c = 0; c < COMP; ++c) {
+					const T s = S[c];
+					const T* p = _p[c].data();
+					for (size_t a = 0; a < _count; ++a) tau[a] += s * p[a];
+				}
+			}
+
+			// L = sum_a gamma[a] * P_a
+			void velocity_gradient(const T* gamma, T* L) const {
+				for (size_t c = 0; c < COMP; ++c) {
+					const T* p = _p[c].data();
+					T sum = T(0);
+					for (size_t a = 0; a < _count; ++a) sum += gamma[a] * p[a];
+					L[c] = sum;
+				}
+			}
+
+			// batch of count grains: component c of the grain k at S[c * count + k], tau of the system a at tau[a * count + k]
+			void resolved_shear(const T* S, size_t count, T* tau) const {
+				for (size_t a = 0; a < _count; ++a) {
+					T* dst = tau + a * count;
+					for (size_t k = 0; k < count; ++k) dst[k] = T(0);
+					for (size_t c = 0; c < COMP; ++c) {
+						const T p = _p[c][a];
+						const T* src = S + c * count;
+						for (size_t k = 0; k < count; ++k) dst[k] += p * src[k];
+					}
+				}
+			}
+
+			// batch of count grains: gamma of the system a at gamma[a * count + k], component c of L at L[c * count + k]
+			void velocity_gradient(const T* gamma, size_t count, T* L) const {
+				for (size_t c = 0; c < COMP; ++c) {
+					T* dst = L + c * count;
+					for (size_t k = 0; k < count; ++k) dst[k] = T(0);
+					for (size_t a = 0; a < _count; ++a) {
+						const T p = _p[c][a];
+						const T* src = gamma + a * count;
+						for (size_t k = 0; k < count; ++k) dst[k] += p * src[k];
+					}
+				}
+			}
+		};
+	}
+}
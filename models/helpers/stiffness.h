@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include "../../tensor/container.h"
+
+namespace model {
+	/*
+		Anisotropic elastic stiffness as a 9x9 matrix on container components: s[p] = sum_q K[p][q] * e[q], p = (i, j), q = (k, l)
+		constants C are given at the material axes M, K is C rotated to the basis B of the point (rows of M and B at the lab basis):
+			K_ijkl = Q_ai * Q_bj * Q_ck * Q_dl * C_abcd, Q = M.Bt
+		the rotation costs ~1500 multiplications, so K is computed once per orientation and cached with the basis
+		it was computed for, it is recomputed only when components of the basis of the point change
+		(an object is owned by one relation)
+	*/
+	template<typename T>
+	class RotatedStiffness {
+		static constexpr size_t N = 9;
+		// Voigt index of the container component, layout { 00, 11, 22, 12, 02, 01, 21, 20, 10 }
+		static constexpr size_t VOIGT[N] = { 0, 1, 2, 3, 4, 5, 3, 4, 5 };
+
+		std::array<T, N * N> _c{}; // at the material axes
+		std::array<T, N * N> _k{}; // at the cached basis
+		tens::M3x3<T> _material;
+		tens::M3x3<T> _basis;
+		bool _cached = false;
+		size_t _rotations = 0;
+
+		void rotate() {
+			tens::M3x3<T> Q(tens::FILL_TYPE::ZERO);
+			math::dim3::mat_scal_mat_transp(_material.data(), _basis.data(), Q.data());
+			// P[p][r] = Q_ai * Q_bj, p = (i, j), r = (a, b): K = P.C.Pt
+			std::array<T, N * N> P, CPt;
+			for (size_t i = 0; i < 3; ++i)
+				for (size_t j = 0; j < 3; ++j)
+					for (size_t a = 0; a < 3; ++a)
+						for (size_t b = 0; b < 3; ++b)
+							P[math::dim3::IDX[i][j] * N + math::dim3::IDX[a][b]] = Q[math::dim3::IDX[a][i]] * Q[math::dim3::IDX[b][j]];
+			for (size_t r = 0; r < N; ++r) {
+				for (size_t q = 0; q < N; ++q) {
+					T sum = T(0);
+					for (size_t s = 0; s < N; ++s) sum += _c[r * N + s] * P[q * N + s];
+					CPt[r * N + q] = sum;
+				}
+			}
+			for (size_t p = 0; p < N; ++p) {
+				for (size_t q = 0; q < N; ++q) {
+					T sum = T(0);
+					for (size_t r = 0; r < N; ++r) sum += P[p * N + r] * CPt[r * N + q];
+					_k[p * N + q] = sum;
+				}
+			}
+			_rotations++;
+		}
+	public:
+		// voigt - 6x6 constants (11, 22, 33, 23, 13, 12) row by row
+		RotatedStiffness(const std::array<T, 36>& voigt, const tens::M3x3<T>& material) :
+			_material(material), _basis(material)
+		{
+			for (size_t p = 0; p < N; ++p)
+				for (size_t q = 0; q < N; ++q)
+					_c[p * N + q] = voigt[VOIGT[p] * 6 + VOIGT[q]];
+		};
+
+		// K at the basis, rotated only if the basis differs from the cached one
+		const std::array<T, N * N>& at(const tens::M3x3<T>& basis) {
+			if (!_cached || !std::equal(_basis.data(), _basis.data() + N, basis.data())) {
+				std::copy(basis.data(), basis.data() + N, _basis.data());
+				rotate();
+				_cached = true;
+			}
+			return _k;
+		}
+
+		// s = K : e at the basis
+		tens::M3x3<T> operator()(const tens::M3x3<T>& basis, const tens::M3x3<T>& e) {
+			const auto& K = at(basis);
+			tens::M3x3<T> s(tens::FILL_TYPE::ZERO);
+			for (size_t p = 0; p < N; ++p) {
+				T sum = T(0);
+				for (size_t q = 0; q < N; ++q) sum += K[p * N + q] * e[q];
+				s[p] = sum;
+			}
+			return s;
+		}
+
+		const tens::M3x3<T>& material_axes() const { return _material; };
+
+		// material axes restored from a packed state, K is recomputed by the next call if they differ
+		void set_material_axes(const T* material) {
+			if (!std::equal(material, material + N, _material.data())) {
+				std::copy(material, material + N, _material.data());
+				_cached = false;
+			}
+		};
+
+		// number of computed rotations (cache misses)
+		size_t rotations() const { return _rotations; };
+	};
+}
@@ -22,22 +22,63 @@ namespace model {
 		std::shared_ptr<StrainMeasure<T>> F_e;
 	public:
 		Plasticity(const json& params, measure::type_schema type) :
-			Elasticity<StrainMeasure, StressMeasure, T>(params, type)
+			Plasticity(ModelParams<T>::parse(params), tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM), type)
 		{
-			const auto curve = parse_json_value<std::vector<std::pair<T, T>>>("curve", params);
-			const auto treshold = parse_json_value<T>("flow_treshold", params);
-			F_in = std::make_shared<PlasticRelation<StressMeasure, StrainMeasure, T>>(type, *this, this->S, this->F, curve, this->elast_modulus[1], treshold);
+		};
+
+		// builds a point from already parsed and validated params (no file I/O, no parsing)
+		Plasticity(const std::shared_ptr<const ModelParams<T>>& params, const Basis<T, 3>& basis, measure::type_schema type) :
+			Elasticity<StrainMeasure, StressMeasure, T>(params, basis, type)
+		{
+			if (!params->curve) {
+				throw std::invalid_argument("Param of plastic model 'curve' was not found");
+			}
+			if (params->anisotropy) {
+				throw std::invalid_argument("Param 'anisotropy' is not supported by the isotropic plastic model");
+			}
+			F_in = std::make_shared<PlasticRelation<StressMeasure, StrainMeasure, T>>(type, *this, this->S, this->F, params->curve, this->elast_modulus, params->flow_treshold, params->return_mapping);
 			F_e = std::make_shared<StrainDecomposition<StrainMeasure, T>>(type, *this, this->F, this->F_in);
 			this->reset_elastic_strain_measure(this->F_e); // change S(F) -> S(F_e)
+			this->register_measure(F_in);
+			this->register_measure(F_e);
 		};
 
-		virtual void calc(T dt) override {
+		// switches the implicit (return mapping) mode of the plastic relation of the point
+		void set_return_mapping(const ReturnMappingParams<T>& params) {
+			static_cast<PlasticRelation<StressMeasure, StrainMeasure, T>&>(*F_in).set_return_mapping(params);
+		}
+
+		const ReturnMappingDiagnostics<T>& return_mapping_diagnostics() const {
+			return static_cast<const PlasticRelation<StressMeasure, StrainMeasure, T>&>(*F_in).return_mapping_diagnostics();
+		}
+
+		// a new step forgets the classification of an unfinished one
+		virtual void init() override {
+			static_cast<PlasticRelation<StressMeasure, StrainMeasure, T>&>(*F_in).reset_activity();
+		};
+
+		virtual void calc_loading(T dt) override {
 			this->F->calc(dt); // loading -> L / F
+		};
+
+		virtual activity classify(T dt) override {
+			return static_cast<PlasticRelation<StressMeasure, StrainMeasure, T>&>(*F_in).classify(dt);
+		};
+
+		virtual void calc_response(T dt) override {
 			this->F_in->calc(dt);  // plastic relation -> L_in / F_in
 			this->F_e->calc(dt); // strain decomposition L_e / F_e
 			this->S->calc(dt); // elastic relation -> S_rate / S
 		};
 
+		// the point is classified elastic: L_in = 0 (F_in = I), L_e = L (F_e = F) without inversion of F_e
+		virtual void calc_elastic_response(T dt) override {
+			this->F_in->calc(dt);
+			static_cast<StrainDecomposition<StrainMeasure, T>&>(*F_e).set_elastic();
+			this->F_e->calc(dt);
+			this->S->calc(dt);
+		};
+
 		virtual std::ostream& print_measures(std::ostream& out) const override {
 			out << *this->F << std::endl;
 			out << *this->F_in << std::endl;
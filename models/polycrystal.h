@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include "./factory.h"
+
+namespace model {
+	/*
+		Polycrystal of grains of a model (Taylor assumption):
+			- every grain is a material point with own orientation (basis) and volume fraction
+			- the macroscopic loading (L or F at the lab basis) is imposed on every grain rotated into its basis
+			- the macroscopic Cauchy stress is the volume average of stresses of grains at the lab basis
+		a step runs grains in contiguous ranges per thread; the weighted stresses of grains are summed in blocks
+		of REDUCTION_BLOCK grains in parallel and block sums are added in the order of blocks,
+		so the result does not depend on the number of threads;
+		grains of CrystalPlasticity are stepped in blocks of SlipBatch (slip sums vectorized across grains of the block)
+	*/
+	template<
+		template<template<class> class, template<class> class, class> class Model,
+		template<class T> class StrainMeasure = strain::GradDeform,
+		template<class T> class StressMeasure = stress::CaushyStress,
+		typename T = double>
+	class Polycrystal {
+	public:
+		using grain_type = Model<StrainMeasure, StressMeasure, T>;
+		static constexpr size_t REDUCTION_BLOCK = 64;
+	private:
+		std::shared_ptr<const strain::loading::Path<T>> _loading;
+		std::vector<std::shared_ptr<grain_type>> _grains;
+		std::vector<T> _fractions; // normalized
+		std::vector<numerical_schema::step_status> _status;
+		std::vector<tens::M3x3<T>> _weighted; // fraction * stress of the grain at the lab basis
+		std::vector<tens::M3x3<T>> _blocks;   // partial sums
+		std::vector<SlipBatch<T>> _slip;      // a batch of crystal grains per thread
+		tens::M3x3<T> _stress;
+		T _t = 0;
+
+		// fraction * Bt.S.B
+		void weighted_stress(size_t idx) {
+			const auto& B = *_grains[idx]->basis();
+			tens::M3x3<T>& dst = _weighted[idx];
+			dst = B.transpose();
+			dst *= _grains[idx]->stress()->value();
+			dst *= B;
+			dst *= _fractions[idx];
+		}
+
+		void reduce_blocks(size_t begin, size_t end) {
+			for (size_t block = begin; block < end; ++block) {
+				auto& sum = _blocks[block];
+				sum.fill_value(tens::FILL_TYPE::ZERO);
+				for (size_t idx = block * REDUCTION_BLOCK; idx < std::min(size(), (block + 1) * REDUCTION_BLOCK); ++idx) {
+					sum += _weighted[idx];
+				}
+			}
+		}
+
+	public:
+		// fractions are normalized, the default loading of a point is imposed at the lab basis if loading is empty
+		Polycrystal(const std::shared_ptr<const ModelParams<T>>& params, const std::vector<Basis<T, 3>>& bases, const std::vector<T>& fractions,
+			measure::type_schema type, const std::shared_ptr<const strain::loading::Path<T>>& loading = nullptr) :
+			_loading(loading ? loading : std::make_shared<const strain::loading::Default<T>>()),
+			_fractions(fractions),
+			_status(bases.size(), numerical_schema::step_status::OK),
+			_weighted(bases.size(), tens::M3x3<T>(tens::FILL_TYPE::ZERO)),
+			_blocks((bases.size() + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK, tens::M3x3<T>(tens::FILL_TYPE::ZERO)),
+			_stress(tens::FILL_TYPE::ZERO)
+		{
+			if (fractions.size() != bases.size()) {
+				throw std::invalid_argument("Polycrystal: number of fractions is not equal to number of grains");
+			}
+			T total = T(0);
+			for (const T fraction : fractions) {
+				if (fraction < T(0)) {
+					throw std::invalid_argument("Polycrystal: volume fraction is negative");
+				}
+				total += fraction;
+			}
+			if (!(total > T(0))) {
+				throw std::invalid_argument("Polycrystal: sum of volume fractions is not positive");
+			}
+			for (auto& fraction : _fractions) {
+				fraction /= total;
+			}
+			_grains.reserve(bases.size());
+			for (const auto& basis : bases) {
+				_grains.push_back(std::make_shared<grain_type>(params, basis, type));
+				_grains.back()->strain()->set_path(std::make_shared<const strain::loading::Rotated<T>>(_loading, *basis));
+			}
+		};
+
+		// count grains of equal fractions with random orientations, the orientation of the grain i depends only on (seed, i)
+		Polycrystal(const std::shared_ptr<const ModelParams<T>>& params, size_t count, unsigned seed,
+			measure::type_schema type, const std::shared_ptr<const strain::loading::Path<T>>& loading = nullptr) :
+			Polycrystal(params, random_bases<T>(count, seed), std::vector<T>(count, T(1)), type, loading) {};
+
+		size_t size() const { return _grains.size(); };
+		T t() const { return _t; };
+		grain_type& grain(size_t idx) { return *_grains[idx]; };
+		const grain_type& grain(size_t idx) const { return *_grains[idx]; };
+		T fraction(size_t idx) const { return _fractions[idx]; };
+		const std::shared_ptr<const strain::loading::Path<T>>& loading() const { return _loading; };
+		// statuses of grains at the last step (see try_step)
+		const std::vector<numerical_schema::step_status>& status() const { return _status; };
+
+		// volume averaged Cauchy stress at the lab basis
+		const tens::M3x3<T>& stress() const { return _stress; };
+
+		// step of all grains, returns the number of failed grains (their stresses are taken as they are)
+		size_t step(T dt, size_t threads = 1) {
+			if constexpr (requires (grain_type& grain) { grain.slip().take_velocity_gradient(nullptr, 0); }) {
+				if (_slip.size() < thread_count(size(), threads)) {
+					_slip.resize(thread_count(size(), threads));
+				}
+				parallel(size(), threads, [&](size_t begin, size_t end, size_t thread_idx) {
+					for (size_t block = begin; block < end; block += SlipBatch<T>::BLOCK) {
+						_slip[thread_idx].step(_grains, block, std::min(end, block + SlipBatch<T>::BLOCK), dt, _status.data());
+					}
+				});
+			} else {
+				parallel(size(), threads, [&](size_t begin, size_t end) {
+					for (size_t idx = begin; idx < end; ++idx) {
+						_status[idx] = _grains[idx]->try_step(dt);
+					}
+				});
+			}
+			average(threads);
+			_t += dt;
+			size_t failed = 0;
+			for (const auto status : _status) {
+				failed += status == numerical_schema::step_status::OK ? 0 : 1;
+			}
+			return failed;
+		};
+
+		// recalculates the average stress of the current state of grains
+		void average(size_t threads = 1) {
+			parallel(size(), threads, [&](size_t begin, size_t end) {
+				for (size_t idx = begin; idx < end; ++idx) {
+					weighted_stress(idx);
+				}
+			});
+			parallel(_blocks.size(), threads, [&](size_t begin, size_t end) {
+				reduce_blocks(begin, end);
+			});
+			_stress.fill_value(tens::FILL_TYPE::ZERO);
+			for (const auto& sum : _blocks) {
+				_stress += sum;
+			}
+		};
+	};
+}
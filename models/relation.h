@@ -1,24 +1,27 @@
 #pragma once
 #include "../state-measure/state.h"
 #include "./helpers/model_utils.h"
+#include "./helpers/stiffness.h"
 
 namespace model {
 	using namespace state;
 	using namespace measure;
 
-	// binary relatoin G(x) : S(F)
-	template<template<class> class StressMeasure, template<class> class StrainMeasure, typename T>
-	class ElasticRelation : public StressMeasure<T> {
-	private:
-		void set_elast_modules_l_mu(T l, T mu) {
+	/*
+		isotropic elastic modules (Lame l, mu), shear components are s_ij = 2mu * (e_ij + e_ji),
+		i.e. the relation is the cubic one (see RotatedStiffness) of C11 = l + 2mu, C12 = l, C44 = 2mu
+	*/
+	template<typename T>
+	struct ElasticModules {
+		std::array<T, 9> c{ T(0) };
+
+		ElasticModules(T l, T mu) {
 			c[0] = c[1] = c[2] = l + 2 * mu;
 			c[3] = c[4] = c[5] = l;
 			c[6] = c[7] = c[8] = 2 * mu;
 		}
-	protected:
-		std::shared_ptr<const StrainMeasure<T>> F_e;
-		std::array<T, 9> c;
-		tens::M3x3<T> strain_mul_modules(const tens::M3x3<T> &e) {
+
+		tens::M3x3<T> operator()(const tens::M3x3<T>& e) const {
 			/*  -------------- s = c.e ------------------
 			    c0 c5 c4  0  0  0   |e0|   |s0|
 				c5 c1 c3  0  0  0   |e1|   |s1|
@@ -33,14 +36,24 @@ namespace model {
 								   c[6] * (e[3] + e[6]),  c[7] * (e[4] + e[7]),  c[8] * (e[5] + e[8]),
 						           c[6] * (e[3] + e[6]),  c[7] * (e[4] + e[7]),  c[8] * (e[5] + e[8])});
 		}
+	};
+
+	// binary relatoin G(x) : S(F)
+	template<template<class> class StressMeasure, template<class> class StrainMeasure, typename T>
+	class ElasticRelation : public StressMeasure<T> {
+	protected:
+		std::shared_ptr<const StrainMeasure<T>> F_e;
+		const ElasticModules<T> c;
+		virtual tens::M3x3<T> strain_mul_modules(const tens::M3x3<T> &e) {
+			return c(e);
+		}
 	public:
 		ElasticRelation(measure::type_schema type, MaterialPoint<T, 3>& state, 
 			const std::shared_ptr<const StrainMeasure<T>>& _F_e, const std::array<T, 2>& _c) :
 			StressMeasure<T>(state, type), 
 			F_e(_F_e),
-			c{T(0)}
+			c(_c[0], _c[1])
 		{
-			set_elast_modules_l_mu(_c[0], _c[1]);
 		};
 
 		void reset_elastic_strain_measure(std::shared_ptr<const StrainMeasure<T>>& new_F_e) {
@@ -58,48 +71,275 @@ namespace model {
 		}
 	};
 
+	/*
+		Anisotropic elastic relation G(x) : S(F), S = K : x
+		constants are given at the material axes (the basis of the point at creation, i.e. the crystal lattice),
+		the stiffness K at the current basis of the point is cached (see RotatedStiffness),
+		shear components are s_ij = C44 * (e_ij + e_ji) (the isotropic relation of l, mu has C44 = 2mu, see ElasticModules)
+		material axes are a part of the packed state, so a point restored from a checkpoint keeps the lattice of the saved one
+	*/
+	template<template<class> class StressMeasure, template<class> class StrainMeasure, typename T>
+	class AnisotropicElasticRelation : public ElasticRelation<StressMeasure, StrainMeasure, T> {
+	protected:
+		RotatedStiffness<T> K;
+		virtual tens::M3x3<T> strain_mul_modules(const tens::M3x3<T>& e) override {
+			return K(*this->get_basis_ref(), e);
+		}
+	public:
+		AnisotropicElasticRelation(measure::type_schema type, MaterialPoint<T, 3>& state,
+			const std::shared_ptr<const StrainMeasure<T>>& _F_e, const std::array<T, 2>& _c, const AnisotropyParams<T>& anisotropy) :
+			ElasticRelation<StressMeasure, StrainMeasure, T>(type, state, _F_e, _c),
+			K(anisotropy.voigt, *state.basis())
+		{
+		};
+
+		const RotatedStiffness<T>& stiffness() const {
+			return K;
+		}
+
+		// packed state of the measure and material axes
+		virtual size_t state_size() const override {
+			return StressMeasure<T>::state_size() + 9;
+		};
+
+		virtual void write_state(T* dst) const override {
+			StressMeasure<T>::write_state(dst);
+			const auto& M = K.material_axes();
+			std::copy(M.data(), M.data() + 9, dst + StressMeasure<T>::state_size());
+		};
+
+		virtual void read_state(const T* src) override {
+			StressMeasure<T>::read_state(src);
+			K.set_material_axes(src + StressMeasure<T>::state_size());
+		};
+	};
+
+	// state of the plastic relation in the current step
+	enum class activity {
+		UNKNOWN,
+		ELASTIC,
+		PLASTIC
+	};
+
+	// convergence diagnostics of the return mapping of a point
+	template<typename T>
+	struct ReturnMappingDiagnostics {
+		size_t elastic_steps = 0;    // (trial) state is inside the yield surface
+		size_t plastic_steps = 0;
+		size_t yield_crossings = 0;  // steps with elastic and plastic parts (local Newton solve)
+		size_t iterations = 0;       // total Newton iterations
+		size_t max_iterations = 0;   // per one solve
+		size_t failures = 0;         // solves not converged within max_iterations
+		T max_residual = T(0);       // relative residual of the consistency condition at exit
+	};
+
 	template<template<class> class StressMeasure, template<class> class StrainMeasure, typename T>
 	class PlasticRelation : public StrainMeasure<T> {
 	protected:
 		std::shared_ptr<const StressMeasure<T>> S;
 		std::shared_ptr<const StrainMeasure<T>> F;
-		const Curve<T> curve;
-		const T mu;
+		const std::shared_ptr<const Curve<T>> curve; // shared between all points of the same params
+		const ElasticModules<T> c;
 		const T flow_treshold;
+		ReturnMappingParams<T> return_mapping;
+		ReturnMappingDiagnostics<T> diagnostics;
+		activity _activity = activity::UNKNOWN;
+		// elastic predictor of the rate form computed by classify, consumed by return_mapping_rate
+		bool _trial = false;
+		tens::M3x3<T> _dS;
+		T _s_tr = T(0);
+
+		static T stress_intensity(const tens::M3x3<T>& S) {
+			return std::sqrt(1.5 * convolution_transp(S, S));
+		}
+
+		/*
+			consistency condition |S_n + theta * dS| = flow_treshold, solved by Newton for theta in [0, 1]
+			a degenerate solve (the trial stress does not leave the surface, zero stress or zero slope) stops
+			with the last theta and is counted as a failure
+		*/
+		T yield_crossing(const tens::M3x3<T>& S_n, const tens::M3x3<T>& dS, T s_n, T s_tr) {
+			T residual = std::abs(s_n - flow_treshold) / flow_treshold;
+			size_t iter = 0;
+			if (!(s_tr > s_n)) {
+				diagnostics.failures++;
+				diagnostics.max_residual = std::max(diagnostics.max_residual, residual);
+				return T(0);
+			}
+			T theta = std::clamp((flow_treshold - s_n) / (s_tr - s_n), T(0), T(1));
+			auto S_theta = dS;
+			for (; iter < return_mapping.max_iterations; ++iter) {
+				((S_theta = dS) *= theta) += S_n;
+				const T s = stress_intensity(S_theta);
+				residual = std::abs(s - flow_treshold) / flow_treshold;
+				if (residual <= return_mapping.tolerance) break;
+				if (!(s > T(0))) break;
+				const T ds = T(1.5) * convolution_transp(S_theta, dS) / s;
+				if (!(std::abs(ds) > T(0))) break;
+				theta = std::clamp(theta - (s - flow_treshold) / ds, T(0), T(1));
+			}
+			diagnostics.iterations += iter;
+			diagnostics.max_iterations = std::max(diagnostics.max_iterations, iter);
+			diagnostics.max_residual = std::max(diagnostics.max_residual, residual);
+			if (residual > return_mapping.tolerance) diagnostics.failures++;
+			return theta;
+		}
+
+		// elastic predictor of the rate form: increment dS and intensity of S_n + dS
+		void trial_stress(T dt) {
+			_dS = c(this->F->rate());
+			_dS *= dt;
+			auto S_tr = _dS;
+			S_tr += S->value();
+			_s_tr = stress_intensity(S_tr);
+			_trial = true;
+		}
+
+		/*
+			implicit rate form: the step crossing the yield surface is split by the consistency condition (elastic part theta),
+			the plastic part of L is the exact mean of the curve over the plastic part of the step
+		*/
+		void return_mapping_rate(T dt) {
+			const auto& L = this->F->rate();
+			auto& L_in = this->rate_temp;
+			const T s_n = S->value_intensity();
+			T theta = T(0);
+			if (s_n < flow_treshold) {
+				const auto& S_n = S->value();
+				if (!_trial) {
+					trial_stress(dt);
+				}
+				theta = yield_crossing(S_n, _dS, s_n, _s_tr);
+				diagnostics.yield_crossings++;
+			}
+			_trial = false;
+			const T iE = this->F->value_intensity();
+			const T iE_yield = std::max(T(0), iE - (1 - theta) * dt * this->F->rate_intensity());
+			L_in = L;
+			L_in *= (1 - theta) * curve->mean(iE_yield, iE);
+		}
+
+		/*
+			the finite form F_in = I + (F - I) * curve(iE) is a total relation, there is no increment for a plastic corrector,
+			so the implicit mode is defined for the rate form only
+		*/
+		static const ReturnMappingParams<T>& validate(measure::type_schema type, const ReturnMappingParams<T>& params) {
+			if (params.enabled && type == measure::type_schema::FINITE_CALCULATE) {
+				throw std::invalid_argument("Param 'return_mapping' is supported only by RATE_CALCULATE numerical schema");
+			}
+			return params;
+		}
+
+		// classification of the current step, consumed by the next rate/finite equation
+		bool take_plastic(T dt) {
+			const bool plastic = (_activity == activity::UNKNOWN ? classify(dt) : _activity) == activity::PLASTIC;
+			_activity = activity::UNKNOWN;
+			plastic ? diagnostics.plastic_steps++ : diagnostics.elastic_steps++;
+			return plastic;
+		}
 	public:
 		PlasticRelation(measure::type_schema type, MaterialPoint<T, 3>& state, 
 			const std::shared_ptr<const StressMeasure<T>> _S, 
 			const std::shared_ptr<const StrainMeasure<T>> _F,
-			const std::vector<std::pair<T, T>>& _curve, T _mu, T _flow_treshold) :
+			const std::shared_ptr<const Curve<T>>& _curve, const std::array<T, 2>& _c, T _flow_treshold,
+			const ReturnMappingParams<T>& _return_mapping = ReturnMappingParams<T>()) :
 			StrainMeasure<T>(state, type, "F_in"),
-			S(_S), F(_F), curve(_curve), mu(_mu), flow_treshold(_flow_treshold)
+			S(_S), F(_F), curve(_curve), c(_c[0], _c[1]), flow_treshold(_flow_treshold),
+			return_mapping(validate(type, _return_mapping)), _dS(tens::FILL_TYPE::ZERO)
 		{
 		};
 
+		// forgets the classification and the trial stress of an unfinished step (a new step, a failed step, a restored state)
+		void reset_activity() {
+			_activity = activity::UNKNOWN;
+			_trial = false;
+		}
+
+		void set_return_mapping(const ReturnMappingParams<T>& params) {
+			return_mapping = validate(this->_type, params);
+		}
+
+		const ReturnMappingDiagnostics<T>& return_mapping_diagnostics() const {
+			return diagnostics;
+		}
+
+		void reset_return_mapping_diagnostics() {
+			diagnostics = ReturnMappingDiagnostics<T>();
+		}
+
+		/*
+			elastic/plastic state of the point in the current step (the loading F must be already calculated)
+			explicit mode: by the stress of the previous step, implicit mode: by the trial stress (elastic predictor)
+			the result is used by the next rate/finite equation, so a batch may classify all points before the update
+		*/
+		activity classify(T dt) {
+			bool plastic;
+			if (return_mapping.enabled) {
+				trial_stress(dt);
+				plastic = _s_tr > flow_treshold;
+			} else {
+				const auto iS = S->value_intensity();
+				plastic = this->_type == measure::type_schema::FINITE_CALCULATE ? iS > flow_treshold : !(iS < flow_treshold);
+			}
+			return _activity = plastic ? activity::PLASTIC : activity::ELASTIC;
+		}
+
 		virtual void rate_equation(T t, T dt) override {
-			const auto& L = this->F->rate();
-			const auto iS = S->value_intensity();
 			auto& L_in = this->rate_temp;
-			if (iS < flow_treshold) {
+			if (!take_plastic(dt)) {
 				L_in.fill(0);
-			} else {
-				L_in = L;
-				const auto iE = this->F->value_intensity();
-				const T plastic_part = curve.value(iE);
-				L_in *= plastic_part;
+				_trial = false;
+				return;
 			}
+			if (return_mapping.enabled) {
+				return_mapping_rate(dt);
+				return;
+			}
+			L_in = this->F->rate();
+			const auto iE = this->F->value_intensity();
+			const T plastic_part = curve->value(iE);
+			L_in *= plastic_part;
 		};
 
 		virtual void finite_equation(T t, T dt) override {
-			const auto& F = this->F->value();
-			const auto iS = S->value_intensity();
 			auto& F_in = this->value_temp = I3x3<T>;
-			if (iS > flow_treshold) {
+			if (take_plastic(dt)) {
+				const auto& F = this->F->value();
 				const auto iE = this->F->value_intensity();
-				const T plastic_part = curve.value(iE);
+				const T plastic_part = curve->value(iE);
 				F_in += (F - I3x3<T>) * plastic_part;
 			}
 		};
+
+		// packed state of the measure and diagnostics (the classification is not a state between steps)
+		static constexpr size_t DIAGNOSTICS_SIZE = 7;
+
+		virtual size_t state_size() const override {
+			return StrainMeasure<T>::state_size() + DIAGNOSTICS_SIZE;
+		};
+
+		virtual void write_state(T* dst) const override {
+			StrainMeasure<T>::write_state(dst);
+			dst += StrainMeasure<T>::state_size();
+			const auto& d = diagnostics;
+			const T packed[DIAGNOSTICS_SIZE] = { T(d.elastic_steps), T(d.plastic_steps), T(d.yield_crossings),
+				T(d.iterations), T(d.max_iterations), T(d.failures), d.max_residual };
+			std::copy(packed, packed + DIAGNOSTICS_SIZE, dst);
+		};
+
+		virtual void read_state(const T* src) override {
+			StrainMeasure<T>::read_state(src);
+			src += StrainMeasure<T>::state_size();
+			auto& d = diagnostics;
+			d.elastic_steps = static_cast<size_t>(src[0]);
+			d.plastic_steps = static_cast<size_t>(src[1]);
+			d.yield_crossings = static_cast<size_t>(src[2]);
+			d.iterations = static_cast<size_t>(src[3]);
+			d.max_iterations = static_cast<size_t>(src[4]);
+			d.failures = static_cast<size_t>(src[5]);
+			d.max_residual = src[6];
+			reset_activity();
+		};
 	};
 
 	template< template<class> class StrainMeasure, typename T>
@@ -107,6 +347,7 @@ namespace model {
 	protected:
 		std::shared_ptr<const StrainMeasure<T>> F;
 		std::shared_ptr<const StrainMeasure<T>> F_in;
+		bool _elastic = false; // L_in = 0 (F_in = I) in the current step
 	public:
 		StrainDecomposition(measure::type_schema type, MaterialPoint<T, 3>& state, 
 			const std::shared_ptr<const StrainMeasure<T>> _F, 
@@ -116,7 +357,16 @@ namespace model {
 			F_in(_F_in)
 		{};
 
+		// the next equation is of the elastic step: L_e = L (F_e = F), no inversion of F_e
+		void set_elastic() {
+			_elastic = true;
+		}
+
 		virtual void rate_equation(T t, T dt) override {
+			if (std::exchange(_elastic, false)) {
+				this->rate_temp = F->rate();
+				return;
+			}
 			const auto& F_e = this->value();
 			auto& L_e = this->rate_temp = F->rate(); // L
 			auto L_in = F_e; // F_e
@@ -126,6 +376,10 @@ namespace model {
 		};
 
 		virtual void finite_equation(T t, T dt) override {
+			if (std::exchange(_elastic, false)) {
+				this->value_temp = F->value();
+				return;
+			}
 			this->value_temp = F->value() * F_in->value().inverse();
 		};
 	};
@@ -0,0 +1,302 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+#include "./factory.h"
+
+namespace model {
+	/*
+		Local sharding of a batch over processes:
+			- the coordinator compiles params once into the binary format (param_binary.h) and places the image into
+			  a shared memory segment, workers build params on the segment (curves are views, nothing is parsed or copied)
+			- points [0, count) are split into contiguous ranges per shard, the orientation of the point i depends only on (seed, i)
+			- workers write the value of a measure of each point (at the lab basis) and the partial sum of the shard
+			  directly into the result segment, the coordinator reduces partial sums in the order of shards,
+			  so the homogenized value does not depend on scheduling of workers
+			- values of failed points are written but not summed, the mean is over points stepped successfully
+		result segment layout:
+			ResultHeader
+			ShardEntry[shard_count]
+			values                     - comp_size doubles per point, 64 bytes aligned
+	*/
+	namespace shard {
+		constexpr char RESULT_MAGIC[4] = { 'T', 'M', 'S', 'R' };
+		constexpr size_t MAX_COMP_SIZE = 9;
+
+		enum class shard_status : uint32_t {
+			PENDING,
+			DONE,
+			FAILED
+		};
+
+		static_assert(std::atomic<uint32_t>::is_always_lock_free, "status of shards is shared between processes");
+
+		struct ResultHeader {
+			char magic[4];
+			uint32_t shard_count;
+			uint64_t point_count;
+			uint64_t comp_size;
+			uint64_t values_offset; // in bytes from the beginning of the segment
+		};
+
+		struct ShardEntry {
+			std::atomic<uint32_t> status;
+			uint32_t failed_points;
+			uint64_t begin;
+			uint64_t end;
+			double sum[MAX_COMP_SIZE];
+		};
+
+		namespace error {
+			class ShardFailed : public std::exception {
+				std::string _msg;
+			public:
+				ShardFailed(size_t shard, const std::string& reason) :
+					_msg("Shard " + std::to_string(shard) + " was failed \n Reason: " + reason) {};
+				virtual const char* what() const noexcept {
+					return _msg.c_str();
+				};
+			};
+		}
+
+		// typed view of a result segment
+		class ResultView {
+			char* _data;
+		public:
+			explicit ResultView(char* data) : _data(data) {};
+
+			static size_t segment_size(size_t point_count, size_t shard_count, size_t comp_size) {
+				return binary::align(sizeof(ResultHeader) + shard_count * sizeof(ShardEntry), 64) + point_count * comp_size * sizeof(double);
+			}
+
+			// header and pending shards with contiguous ranges of points
+			static void init(char* data, size_t point_count, size_t shard_count, size_t comp_size) {
+				ResultHeader header{};
+				std::memcpy(header.magic, RESULT_MAGIC, sizeof(RESULT_MAGIC));
+				header.shard_count = static_cast<uint32_t>(shard_count);
+				header.point_count = point_count;
+				header.comp_size = comp_size;
+				header.values_offset = binary::align(sizeof(ResultHeader) + shard_count * sizeof(ShardEntry), 64);
+				std::memcpy(data, &header, sizeof(ResultHeader));
+				auto entries = reinterpret_cast<ShardEntry*>(data + sizeof(ResultHeader));
+				for (size_t i = 0; i < shard_count; ++i) {
+					auto entry = new (entries + i) ShardEntry{};
+					entry->begin = i * point_count / shard_count;
+					entry->end = (i + 1) * point_count / shard_count;
+					entry->status.store(static_cast<uint32_t>(shard_status::PENDING), std::memory_order_release);
+				}
+			}
+
+			const ResultHeader& header() const { return *reinterpret_cast<const ResultHeader*>(_data); };
+			ShardEntry& entry(size_t shard) { return reinterpret_cast<ShardEntry*>(_data + sizeof(ResultHeader))[shard]; };
+			const ShardEntry& entry(size_t shard) const { return reinterpret_cast<const ShardEntry*>(_data + sizeof(ResultHeader))[shard]; };
+			double* values(size_t point) { return reinterpret_cast<double*>(_data + header().values_offset) + point * header().comp_size; };
+			const double* values(size_t point) const { return reinterpret_cast<const double*>(_data + header().values_offset) + point * header().comp_size; };
+
+			shard_status status(size_t shard) const {
+				return static_cast<shard_status>(entry(shard).status.load(std::memory_order_acquire));
+			}
+		};
+
+		// work of a shard, everything a worker process needs to know (may be passed by the command line)
+		struct Task {
+			std::string params_segment;
+			std::string result_segment;
+			size_t shard = 0;
+			measure::type_schema type = measure::type_schema::RATE_CALCULATE;
+			size_t steps = 0;
+			double dt = 0;
+			unsigned seed = 0;
+			std::string measure_name = "S";
+		};
+
+		/*
+			Worker side: steps points of the shard and writes results into the result segment
+			failed steps (see try_step) mark the point, the shard is FAILED if any point is failed
+		*/
+		template<
+			template<template<class> class, template<class> class, class> class Model,
+			template<class T> class StrainMeasure = strain::GradDeform,
+			template<class T> class StressMeasure = stress::CaushyStress>
+		void run_worker(const Task& task) {
+			const auto params_memory = std::make_shared<const io::SharedMemory>(io::SharedMemory::open(task.params_segment));
+			const auto params = binary::ParamFile(params_memory).params<double>();
+			auto result_memory = io::SharedMemory::open(task.result_segment, true);
+			ResultView result(result_memory.data());
+			auto& entry = result.entry(task.shard);
+			const size_t comp_size = result.header().comp_size;
+			const auto lab = tens::create_basis<double, 3>();
+
+			std::fill(entry.sum, entry.sum + MAX_COMP_SIZE, 0.0);
+			entry.failed_points = 0;
+			for (size_t i = entry.begin; i < entry.end; ++i) {
+				Model<StrainMeasure, StressMeasure, double> point(params, random_basis<double>(task.seed, i), task.type);
+				bool failed = false;
+				for (size_t s = 0; s < task.steps && !failed; ++s) {
+					failed = point.try_step(task.dt) != numerical_schema::step_status::OK;
+				}
+				const measure::BaseMeasure<double>* source = nullptr;
+				for (const auto& m : point.measures()) {
+					if (m->name() == task.measure_name) source = m.get();
+				}
+				if (source == nullptr || source->comp_size() != comp_size) {
+					throw std::invalid_argument("Shard: measure " + task.measure_name + " is not found or has wrong size");
+				}
+				double* dst = result.values(i);
+				if (comp_size == 9) {
+					tens::container<double, 3, 2> comp;
+					std::memcpy(comp.data(), source->value_data(), comp_size * sizeof(double));
+					const auto at_lab = tens::Tensor<double, 3>(comp, point.basis()).get_comp_at_basis(lab);
+					std::memcpy(dst, at_lab.data(), comp_size * sizeof(double));
+				} else {
+					std::memcpy(dst, source->value_data(), comp_size * sizeof(double));
+				}
+				if (failed) {
+					entry.failed_points++;
+					continue;
+				}
+				for (size_t c = 0; c < comp_size; ++c) {
+					entry.sum[c] += dst[c];
+				}
+			}
+			entry.status.store(static_cast<uint32_t>(entry.failed_points ? shard_status::FAILED : shard_status::DONE), std::memory_order_release);
+		}
+
+		// homogenized (mean) value over points stepped successfully
+		struct Result {
+			std::vector<double> mean;
+			size_t failed_points = 0;
+		};
+
+		/*
+			Coordinator side: owns the param and result segments (names are removed with the coordinator)
+			run() forks a worker process per shard (POSIX), on other systems workers are started by the user
+			with tasks of task() and run_worker(), then reduce() gives the result
+		*/
+		template<
+			template<template<class> class, template<class> class, class> class Model,
+			template<class T> class StrainMeasure = strain::GradDeform,
+			template<class T> class StressMeasure = stress::CaushyStress>
+		class Coordinator {
+			io::SharedMemory _params;
+			io::SharedMemory _result;
+			size_t _shard_count;
+
+			static std::string default_prefix() {
+				static std::atomic<unsigned> counter{ 0 };
+#ifdef _WIN32
+				const unsigned long pid = GetCurrentProcessId();
+#else
+				const long pid = static_cast<long>(getpid());
+#endif
+				return "/tensor_matrix_" + std::to_string(pid) + "_" + std::to_string(counter++);
+			}
+
+			static io::SharedMemory place_params(const json& params, const std::string& name) {
+				const auto image = binary::compile(params);
+				auto memory = io::SharedMemory::create(name, image.size());
+				std::memcpy(memory.data(), image.data(), image.size());
+				return memory;
+			}
+
+		public:
+			Coordinator(const json& params, size_t point_count, size_t shard_count, size_t comp_size = 9, const std::string& prefix = default_prefix()) :
+				_params(place_params(params, prefix + "_params")),
+				_result(io::SharedMemory::create(prefix + "_result", ResultView::segment_size(point_count, std::max<size_t>(1, shard_count), comp_size))),
+				_shard_count(std::max<size_t>(1, shard_count))
+			{
+				if (comp_size > MAX_COMP_SIZE) {
+					throw std::invalid_argument("Shard: comp_size is greater than " + std::to_string(MAX_COMP_SIZE));
+				}
+				ResultView::init(_result.data(), point_count, _shard_count, comp_size);
+			};
+
+			size_t shard_count() const { return _shard_count; };
+			size_t point_count() const { return view().header().point_count; };
+			const std::string& params_segment() const { return _params.name(); };
+			const std::string& result_segment() const { return _result.name(); };
+			const ResultView view() const { return ResultView(const_cast<char*>(_result.data())); };
+
+			Task task(size_t shard, measure::type_schema type, size_t steps, double dt, unsigned seed) const {
+				return Task{ _params.name(), _result.name(), shard, type, steps, dt, seed };
+			}
+
+			// values of the point written by its worker (view into the result segment)
+			const double* values(size_t point) const {
+				return view().values(point);
+			}
+
+			// mean over points stepped successfully, partial sums are reduced in the order of shards
+			Result reduce() const {
+				const auto result = view();
+				Result res;
+				res.mean.assign(result.header().comp_size, 0.0);
+				for (size_t shard = 0; shard < _shard_count; ++shard) {
+					const auto status = result.status(shard);
+					if (status == shard_status::PENDING) {
+						throw error::ShardFailed(shard, "results are not written");
+					}
+					const auto& entry = result.entry(shard);
+					for (size_t c = 0; c < res.mean.size(); ++c) {
+						res.mean[c] += entry.sum[c];
+					}
+					res.failed_points += entry.failed_points;
+				}
+				if (res.failed_points == result.header().point_count && res.failed_points > 0) {
+					throw error::ShardFailed(0, "all points are failed");
+				}
+				for (auto& v : res.mean) {
+					v /= std::max<double>(1.0, double(result.header().point_count - res.failed_points));
+				}
+				return res;
+			}
+
+			// forks a worker per shard and waits for all of them
+			Result run(measure::type_schema type, size_t steps, double dt, unsigned seed) {
+#ifdef _WIN32
+				throw tens::NoImplemetationYet();
+#else
+				std::cout.flush();
+				std::vector<pid_t> workers;
+				for (size_t shard = 0; shard < _shard_count; ++shard) {
+					const pid_t pid = fork();
+					if (pid == 0) {
+						int code = 0;
+						try {
+							run_worker<Model, StrainMeasure, StressMeasure>(task(shard, type, steps, dt, seed));
+						} catch (const std::exception& e) {
+							std::cerr << "Shard " << shard << ": " << e.what() << std::endl;
+							code = 1;
+						}
+						_exit(code);
+					}
+					if (pid < 0) {
+						for (const pid_t worker : workers) {
+							waitpid(worker, nullptr, 0);
+						}
+						throw error::ShardFailed(shard, "fork");
+					}
+					workers.push_back(pid);
+				}
+				size_t failed = workers.size();
+				for (size_t shard = 0; shard < workers.size(); ++shard) {
+					int status = 0;
+					waitpid(workers[shard], &status, 0);
+					if (failed == workers.size() && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+						failed = shard;
+					}
+				}
+				if (failed != workers.size()) {
+					throw error::ShardFailed(failed, "worker process exited abnormally");
+				}
+				return reduce();
+#endif
+			}
+		};
+	}
+}
@@ -0,0 +1,512 @@
+#pragma once
+#include "./elasticity.h"
+
+namespace model {
+	/*
+		Static (CRTP/policy based) variant of the model stack:
+			- the measure set and relations of a model are members of the model, they are linked by references
+			- the numerical schema is a policy, so there is no runtime switch on type_schema
+			- there are no virtual calls and shared_ptr indirections inside a step,
+			  the whole calc of a model may be inlined into one straight-line kernel
+		equations are the same as ones of the virtual stack (Elasticity, Plasticity), which stays for prototyping
+		the static models have the same phases as virtual ones (calc_loading, classify, calc_response),
+		so they may be stepped by BatchUpdate
+		measures keep persistent containers by a storage policy: Inline (own) or View (flat state, see flat_state.h)
+	*/
+	namespace fixed {
+		// numerical schemas (see StateMeasureSchema::calc)
+		namespace schema {
+			struct Rate {
+				static constexpr measure::type_schema type = measure::type_schema::RATE_CALCULATE;
+
+				template<class Measure, typename T>
+				static void calc(Measure& m, T t, T dt) {
+					m.rate_equation(t, dt);
+					m.update_rate();
+					m.integrate_value(dt);
+					m.update_value();
+				}
+			};
+
+			struct Finite {
+				static constexpr measure::type_schema type = measure::type_schema::FINITE_CALCULATE;
+
+				template<class Measure, typename T>
+				static void calc(Measure& m, T t, T dt) {
+					m.finite_equation(t, dt);
+					m.update_value();
+					m.calc_rate(dt);
+					m.update_rate();
+				}
+			};
+		}
+
+		// number of containers of a measure: value, rate, value_prev, rate_prev
+		constexpr size_t MEASURE_SLOTS = 4;
+
+		// storage of a static measure: own containers
+		template<typename T>
+		struct Inline {
+			static constexpr bool owning = true;
+			std::array<tens::M3x3<T>, MEASURE_SLOTS> slots;
+
+			static Inline at(tens::M3x3<T>* hot, size_t measure) { return Inline(); };
+			tens::M3x3<T>* data() { return slots.data(); };
+			const tens::M3x3<T>* data() const { return slots.data(); };
+		};
+
+		// storage of a static measure: view into the flat state of a point (see flat::Batch)
+		template<typename T>
+		struct View {
+			static constexpr bool owning = false;
+			tens::M3x3<T>* slots = nullptr;
+
+			static View at(tens::M3x3<T>* hot, size_t measure) { return View{ hot + measure * MEASURE_SLOTS }; };
+			tens::M3x3<T>* data() { return slots; };
+			const tens::M3x3<T>* data() const { return slots; };
+		};
+
+		/*
+			Base of static measures, Derived may hide integrate_value/calc_rate
+			Derived must implement rate_equation, finite_equation, rate_intensity, value_intensity
+			temporaries are members, persistent containers are given by Storage
+		*/
+		template<class Derived, typename T, class Storage = Inline<T>>
+		class Measure {
+			Storage _storage;
+			const tens::FILL_TYPE _initial;
+		protected:
+			enum slot { VALUE, RATE, VALUE_PREV, RATE_PREV };
+			tens::M3x3<T>& at(slot s) { return _storage.data()[s]; };
+			const tens::M3x3<T>& at(slot s) const { return _storage.data()[s]; };
+
+			tens::M3x3<T> value_temp;
+			tens::M3x3<T> rate_temp;
+		public:
+			Measure(tens::FILL_TYPE type, const Storage& storage = Storage()) :
+				_storage(storage), _initial(type),
+				value_temp(tens::FILL_TYPE::ZERO), rate_temp(tens::FILL_TYPE::ZERO)
+			{
+				if constexpr (Storage::owning) reset();
+			};
+
+			Measure(const Measure&) = delete;
+			Measure& operator= (const Measure&) = delete;
+
+			const tens::M3x3<T>& value() const { return at(VALUE); };
+			const tens::M3x3<T>& rate() const { return at(RATE); };
+			const tens::M3x3<T>& value_prev() const { return at(VALUE_PREV); };
+			const tens::M3x3<T>& rate_prev() const { return at(RATE_PREV); };
+
+			// initial state: value of the fill type, zero rate
+			void reset() {
+				at(VALUE) = at(VALUE_PREV) = tens::M3x3<T>(_initial);
+				at(RATE) = at(RATE_PREV) = tens::M3x3<T>(tens::FILL_TYPE::ZERO);
+			};
+
+			void update_value() {
+				at(VALUE_PREV) = at(VALUE);
+				at(VALUE) = value_temp;
+			};
+
+			void update_rate() {
+				at(RATE_PREV) = at(RATE);
+				at(RATE) = rate_temp;
+			};
+
+			// the first order (Euler) schema to integrate value
+			void integrate_value(T dt) {
+				value_temp = rate();
+				value_temp *= dt;
+				value_temp += value();
+			};
+
+			// the first order schema to calculate rate
+			void calc_rate(T dt) {
+				rate_temp = value();
+				rate_temp -= value_prev();
+				rate_temp /= dt;
+			};
+
+			template<class Schema>
+			void calc(T t, T dt) {
+				Schema::calc(static_cast<Derived&>(*this), t, dt);
+			};
+		};
+
+		// kinematics of deformation gradient (see GradDeform), Derived implements equations
+		template<class Derived, typename T, class Storage>
+		class GradDeformBase : public Measure<Derived, T, Storage> {
+		public:
+			GradDeformBase(const Storage& storage = Storage()) : Measure<Derived, T, Storage>(tens::FILL_TYPE::INDENT, storage) {};
+
+			void integrate_value(T dt) {
+				strain::kinematics::integrate_value(this->rate(), this->value(), dt, this->value_temp);
+			};
+
+			void calc_rate(T dt) {
+				strain::kinematics::calc_rate(this->value_prev(), this->value(), dt, this->rate_temp);
+			};
+
+			tens::M3x3<T> right_hencky() const {
+				return strain::kinematics::right_hencky(this->value());
+			};
+
+			T rate_intensity() const {
+				return strain::kinematics::rate_intensity(this->rate());
+			};
+
+			T value_intensity() const {
+				return strain::kinematics::value_intensity(this->value());
+			};
+		};
+
+		// deformation gradient with the loading of GradDeform
+		template<typename T, class Storage = Inline<T>>
+		class DeformGradient : public GradDeformBase<DeformGradient<T, Storage>, T, Storage> {
+		public:
+			using GradDeformBase<DeformGradient<T, Storage>, T, Storage>::GradDeformBase;
+
+			void rate_equation(T t, T dt) {
+				strain::loading::rate(t, this->rate_temp);
+			};
+
+			void finite_equation(T t, T dt) {
+				strain::loading::value(t, this->value_temp);
+			};
+		};
+
+		// S(F_e), see ElasticRelation
+		template<typename T, class Strain, class Storage = Inline<T>>
+		class ElasticStress : public Measure<ElasticStress<T, Strain, Storage>, T, Storage> {
+			const Strain& F_e;
+			const ElasticModules<T>& c;
+		public:
+			ElasticStress(const Strain& _F_e, const ElasticModules<T>& _c, const Storage& storage = Storage()) :
+				Measure<ElasticStress<T, Strain, Storage>, T, Storage>(tens::FILL_TYPE::INDENT, storage), // initial value as of CaushyStress
+				F_e(_F_e), c(_c) {};
+
+			void rate_equation(T t, T dt) {
+				this->rate_temp = c(F_e.rate());
+			};
+
+			void finite_equation(T t, T dt) {
+				this->value_temp = c(F_e.right_hencky());
+			};
+
+			T rate_intensity() const {
+				return std::sqrt(1.5 * convolution_transp(this->rate(), this->rate()));
+			};
+
+			T value_intensity() const {
+				return std::sqrt(1.5 * convolution_transp(this->value(), this->value()));
+			};
+		};
+
+		// F_in(S, F), see PlasticRelation (explicit mode)
+		template<typename T, class Stress, class Strain, class Storage = Inline<T>>
+		class PlasticStrain : public GradDeformBase<PlasticStrain<T, Stress, Strain, Storage>, T, Storage> {
+			const Stress& S;
+			const Strain& F;
+			const Curve<T>& curve;
+			const T flow_treshold;
+			activity _activity = activity::UNKNOWN;
+
+			bool take_plastic(measure::type_schema type) {
+				const bool plastic = (_activity == activity::UNKNOWN ? classify(type) : _activity) == activity::PLASTIC;
+				_activity = activity::UNKNOWN;
+				return plastic;
+			}
+		public:
+			PlasticStrain(const Stress& _S, const Strain& _F, const Curve<T>& _curve, T _flow_treshold, const Storage& storage = Storage()) :
+				GradDeformBase<PlasticStrain<T, Stress, Strain, Storage>, T, Storage>(storage),
+				S(_S), F(_F), curve(_curve), flow_treshold(_flow_treshold) {};
+
+			void reset_activity() {
+				_activity = activity::UNKNOWN;
+			};
+
+			activity classify(measure::type_schema type) {
+				const auto iS = S.value_intensity();
+				const bool plastic = type == measure::type_schema::FINITE_CALCULATE ? iS > flow_treshold : !(iS < flow_treshold);
+				return _activity = plastic ? activity::PLASTIC : activity::ELASTIC;
+			};
+
+			void rate_equation(T t, T dt) {
+				auto& L_in = this->rate_temp;
+				if (!take_plastic(measure::type_schema::RATE_CALCULATE)) {
+					L_in.fill(0);
+					return;
+				}
+				L_in = F.rate();
+				L_in *= curve.value(F.value_intensity());
+			};
+
+			void finite_equation(T t, T dt) {
+				auto& F_in = this->value_temp = I3x3<T>;
+				if (take_plastic(measure::type_schema::FINITE_CALCULATE)) {
+					F_in += (F.value() - I3x3<T>) * curve.value(F.value_intensity());
+				}
+			};
+		};
+
+		// F_e(F, F_in), see StrainDecomposition
+		template<typename T, class Strain, class PlasticStrain, class Storage = Inline<T>>
+		class ElasticStrain : public GradDeformBase<ElasticStrain<T, Strain, PlasticStrain, Storage>, T, Storage> {
+			const Strain& F;
+			const PlasticStrain& F_in;
+			bool _elastic = false;
+		public:
+			ElasticStrain(const Strain& _F, const PlasticStrain& _F_in, const Storage& storage = Storage()) :
+				GradDeformBase<ElasticStrain<T, Strain, PlasticStrain, Storage>, T, Storage>(storage),
+				F(_F), F_in(_F_in) {};
+
+			// the next equation is of the elastic step: L_e = L (F_e = F), no inversion of F_e
+			void set_elastic() {
+				_elastic = true;
+			}
+
+			void rate_equation(T t, T dt) {
+				if (std::exchange(_elastic, false)) {
+					this->rate_temp = F.rate();
+					return;
+				}
+				const auto& F_e = this->value();
+				auto& L_e = this->rate_temp = F.rate(); // L
+				auto L_in = F_e; // F_e
+				L_in *= F_in.rate(); // F_e.L_in
+				L_in *= F_e.inverse(); // F_e.L_in.F_e^-1
+				L_e -= L_in; //  L - F_e.L_in.F_e^-1
+			};
+
+			void finite_equation(T t, T dt) {
+				if (std::exchange(_elastic, false)) {
+					this->value_temp = F.value();
+					return;
+				}
+				this->value_temp = F.value() * F_in.value().inverse();
+			};
+		};
+
+		/*
+			Measure set and phases of the static Elasticity: F -> S(F)
+			Storage - Inline (own containers) or View (containers of a point in the flat state, see flat::Batch)
+		*/
+		template<class Schema, typename T, template<class> class Storage = Inline>
+		class ElasticityMeasures {
+		public:
+			using strain_type = DeformGradient<T, Storage<T>>;
+			using stress_type = ElasticStress<T, strain_type, Storage<T>>;
+			static constexpr size_t MEASURES_COUNT = 2;
+		protected:
+			const T& _time;
+			strain_type F;
+			stress_type S;
+		public:
+			ElasticityMeasures(const ModelParams<T>& params, const ElasticModules<T>& c, const T& t, tens::M3x3<T>* hot = nullptr) :
+				_time(t),
+				F(Storage<T>::at(hot, 0)),
+				S(F, c, Storage<T>::at(hot, 1)) {};
+
+			// params of the virtual stack the static one does not implement are rejected (the same file would give other physics)
+			static const ModelParams<T>& validate(const ModelParams<T>& params) {
+				if (params.anisotropy) {
+					throw std::invalid_argument("Param 'anisotropy' is not supported by the static pipeline");
+				}
+				return params;
+			}
+
+			static constexpr measure::type_schema numerical_schema_type() { return Schema::type; };
+
+			const strain_type& strain() const { return F; };
+			const stress_type& stress() const { return S; };
+
+			void reset() {
+				F.reset();
+				S.reset();
+			};
+
+			void calc_loading(T dt) {
+				F.template calc<Schema>(_time, dt);
+			};
+
+			activity classify(T dt) {
+				return activity::ELASTIC;
+			};
+
+			void calc_response(T dt) {
+				S.template calc<Schema>(_time, dt);
+			};
+
+			void calc_elastic_response(T dt) {
+				calc_response(dt);
+			};
+
+			void calc(T dt) {
+				calc_loading(dt);
+				calc_response(dt);
+			};
+		};
+
+		/*
+			Measure set and phases of the static Plasticity (explicit plastic relation): F -> F_in(S, F) -> F_e(F, F_in) -> S(F_e)
+			Storage - Inline (own containers) or View (containers of a point in the flat state, see flat::Batch)
+		*/
+		template<class Schema, typename T, template<class> class Storage = Inline>
+		class PlasticityMeasures {
+		public:
+			struct stress_type; // S depends on F_in through F_e, F_in depends on S
+			using strain_type = DeformGradient<T, Storage<T>>;
+			using plastic_strain_type = PlasticStrain<T, stress_type, strain_type, Storage<T>>;
+			using elastic_strain_type = ElasticStrain<T, strain_type, plastic_strain_type, Storage<T>>;
+			struct stress_type : public ElasticStress<T, elastic_strain_type, Storage<T>> {
+				using ElasticStress<T, elastic_strain_type, Storage<T>>::ElasticStress;
+			};
+			static constexpr size_t MEASURES_COUNT = 4;
+		protected:
+			const T& _time;
+			strain_type F;
+			plastic_strain_type F_in;
+			elastic_strain_type F_e;
+			stress_type S;
+
+			static const Curve<T>& curve(const ModelParams<T>& params) {
+				if (!params.curve) {
+					throw std::invalid_argument("Param of plastic model 'curve' was not found");
+				}
+				return *params.curve;
+			}
+		public:
+			// the curve is required, the plastic relation is explicit and isotropic
+			static const ModelParams<T>& validate(const ModelParams<T>& params) {
+				curve(params);
+				if (params.anisotropy) {
+					throw std::invalid_argument("Param 'anisotropy' is not supported by the isotropic plastic model");
+				}
+				if (params.return_mapping.enabled) {
+					throw std::invalid_argument("Param 'return_mapping' is not supported by the static pipeline (explicit plastic relation)");
+				}
+				return params;
+			}
+
+			PlasticityMeasures(const ModelParams<T>& params, const ElasticModules<T>& c, const T& t, tens::M3x3<T>* hot = nullptr) :
+				_time(t),
+				F(Storage<T>::at(hot, 0)),
+				F_in(S, F, curve(params), params.flow_treshold, Storage<T>::at(hot, 1)),
+				F_e(F, F_in, Storage<T>::at(hot, 2)),
+				S(F_e, c, Storage<T>::at(hot, 3)) {};
+
+			static constexpr measure::type_schema numerical_schema_type() { return Schema::type; };
+
+			const strain_type& strain() const { return F; };
+			const plastic_strain_type& plastic_strain() const { return F_in; };
+			const elastic_strain_type& elastic_strain() const { return F_e; };
+			const stress_type& stress() const { return S; };
+
+			void reset() {
+				F.reset();
+				F_in.reset();
+				F_e.reset();
+				S.reset();
+			};
+
+			void calc_loading(T dt) {
+				F.template calc<Schema>(_time, dt); // loading -> L / F
+			};
+
+			activity classify(T dt) {
+				return F_in.classify(Schema::type);
+			};
+
+			void calc_response(T dt) {
+				F_in.template calc<Schema>(_time, dt); // plastic relation -> L_in / F_in
+				F_e.template calc<Schema>(_time, dt); // strain decomposition L_e / F_e
+				S.template calc<Schema>(_time, dt); // elastic relation -> S_rate / S
+			};
+
+			// the point is classified elastic: L_in = 0 (F_in = I), L_e = L (F_e = F)
+			void calc_elastic_response(T dt) {
+				F_in.template calc<Schema>(_time, dt);
+				F_e.set_elastic();
+				F_e.template calc<Schema>(_time, dt);
+				S.template calc<Schema>(_time, dt);
+			};
+
+			void calc(T dt) {
+				calc_loading(dt);
+				calc_response(dt);
+			};
+		};
+
+		// common part of static models: params, orientation, time
+		template<typename T>
+		class Point {
+		protected:
+			std::shared_ptr<const ModelParams<T>> model_param;
+			Basis<T, 3> _basis;
+			const ElasticModules<T> c;
+			T _t = 0;
+		public:
+			Point(const std::shared_ptr<const ModelParams<T>>& params, const Basis<T, 3>& basis) :
+				model_param(params),
+				_basis(basis),
+				c(params->elast_modulus[0], params->elast_modulus[1]) {};
+
+			Point(const Point&) = delete;
+			Point& operator= (const Point&) = delete;
+
+			const std::shared_ptr<const ModelParams<T>>& model_params() const { return model_param; };
+			const Basis<T, 3>& basis() const { return _basis; };
+			T t() const { return _t; };
+
+			void init() {};
+			void finalize() {};
+			void inc_time(T dt) { _t += dt; };
+		};
+
+		/*
+			Static variant of Elasticity: F -> S(F)
+			Schema - schema::Rate or schema::Finite
+		*/
+		template<class Schema, typename T = double>
+		class Elasticity : public Point<T>, public ElasticityMeasures<Schema, T> {
+		public:
+			Elasticity(const json& params) :
+				Elasticity(ModelParams<T>::parse(params), tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM)) {};
+
+			Elasticity(const std::shared_ptr<const ModelParams<T>>& params, const Basis<T, 3>& basis) :
+				Point<T>(params, basis),
+				ElasticityMeasures<Schema, T>(ElasticityMeasures<Schema, T>::validate(*params), this->c, this->_t) {};
+
+			void step(T dt) {
+				this->calc(dt);
+				this->inc_time(dt);
+			};
+		};
+
+		/*
+			Static variant of Plasticity (explicit plastic relation): F -> F_in(S, F) -> F_e(F, F_in) -> S(F_e)
+			Schema - schema::Rate or schema::Finite
+		*/
+		template<class Schema, typename T = double>
+		class Plasticity : public Point<T>, public PlasticityMeasures<Schema, T> {
+		public:
+			Plasticity(const json& params) :
+				Plasticity(ModelParams<T>::parse(params), tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM)) {};
+
+			Plasticity(const std::shared_ptr<const ModelParams<T>>& params, const Basis<T, 3>& basis) :
+				Point<T>(params, basis),
+				PlasticityMeasures<Schema, T>(PlasticityMeasures<Schema, T>::validate(*params), this->c, this->_t) {};
+
+			// a new step forgets the classification of an unfinished one
+			void init() {
+				this->F_in.reset_activity();
+			};
+
+			void step(T dt) {
+				this->calc(dt);
+				this->inc_time(dt);
+			};
+		};
+	}
+}
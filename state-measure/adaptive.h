@@ -0,0 +1,190 @@
+#pragma once
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "../state-measure/state.h"
+#include "../models/helpers/parallel.h"
+
+namespace numerical_schema {
+	using namespace state;
+
+	template<typename T>
+	struct AdaptiveParams {
+		T rtol = T(1e-4);      // relative tolerance of values
+		T atol = T(1e-8);      // absolute tolerance of values
+		T safety = T(0.9);
+		T min_factor = T(0.2); // bounds of dt change per step
+		T max_factor = T(5);
+		T dt_min = T(1e-14);
+		T dt_max = std::numeric_limits<T>::max();
+	};
+
+	struct AdaptiveStatistics {
+		size_t accepted = 0;
+		size_t rejected = 0;
+		size_t failed = 0; // rejected attempts with a failed step (see step_status) or a non-finite error
+
+		AdaptiveStatistics& operator += (const AdaptiveStatistics& rhs) {
+			accepted += rhs.accepted;
+			rejected += rhs.rejected;
+			failed += rhs.failed;
+			return *this;
+		}
+	};
+
+	/*
+		Adaptive stepping of a material point with local truncation error estimation by step doubling:
+		the step dt and two steps dt/2 are made from the same state (see MaterialPoint::save_state),
+		error is the maximum over all measures and components of |x(dt/2, dt/2) - x(dt)| / (atol + rtol*|x|).
+		The step is accepted if error <= 1 (the state after two half steps is kept),
+		the next dt is proposed as dt * safety * error^(-1/2) (the first order schemas)
+		steps are non-throwing (see MaterialPoint::try_step): a failed step or a non-finite error is rejected
+		and dt is shrunk by min_factor, a failure at dt_min stops the subcycling of the point
+	*/
+	template<typename T>
+	class AdaptiveStepper {
+		AdaptiveParams<T> _params;
+		AdaptiveStatistics _stat;
+		step_status _status = step_status::OK; // of the last attempt
+		std::vector<T> _start; // packed state before the step
+		std::vector<T> _full;  // packed state after one step dt
+		std::vector<size_t> _value_offsets; // offsets of values of measures in the packed state
+
+		void prepare(const MaterialPoint<T, 3>& point) {
+			const size_t size = point.state_size();
+			_start.resize(size);
+			_full.resize(size);
+			_value_offsets.clear();
+			size_t offset = size;
+			for (auto it = point.measures().rbegin(); it != point.measures().rend(); ++it) {
+				offset -= (*it)->state_size();
+				_value_offsets.push_back(offset); // value is the first buffer of the packed measure
+			}
+		}
+
+		T error(const MaterialPoint<T, 3>& point) const {
+			T err = T(0);
+			const auto& measures = point.measures();
+			for (size_t m = 0; m < measures.size(); ++m) {
+				const T* full = _full.data() + _value_offsets[measures.size() - 1 - m];
+				const T* half = measures[m]->value_data();
+				for (size_t i = 0; i < measures[m]->comp_size(); ++i) {
+					const T scale = _params.atol + _params.rtol * std::max(std::fabs(full[i]), std::fabs(half[i]));
+					const T e = std::fabs(half[i] - full[i]) / scale;
+					if (!std::isfinite(e)) return std::numeric_limits<T>::infinity();
+					err = std::max(err, e);
+				}
+			}
+			return err;
+		}
+
+	public:
+		AdaptiveStepper(const AdaptiveParams<T>& params = AdaptiveParams<T>()) : _params(params) {};
+
+		const AdaptiveParams<T>& params() const { return _params; };
+		const AdaptiveStatistics& statistics() const { return _stat; };
+		// status of the last attempt: OK or the failure of one of its steps
+		step_status status() const { return _status; };
+
+		// one attempt of the step dt, returns true if the step is accepted (otherwise the state is restored)
+		// dt is replaced with the proposed next step
+		bool try_step(MaterialPoint<T, 3>& point, T& dt) {
+			prepare(point);
+			point.save_state(_start.data());
+			_status = point.try_step(dt);
+			if (_status == step_status::OK) {
+				point.save_state(_full.data());
+				point.load_state(_start.data());
+				_status = point.try_step(dt / 2);
+			}
+			if (_status == step_status::OK) {
+				_status = point.try_step(dt / 2);
+			}
+
+			const T err = _status == step_status::OK ? error(point) : std::numeric_limits<T>::infinity();
+			if (_status == step_status::OK && !std::isfinite(err)) {
+				_status = step_status::NOT_FINITE;
+			}
+			const bool failed = _status != step_status::OK;
+			const bool accepted = !failed && (!(err > T(1)) || dt <= _params.dt_min);
+			const T factor = failed ? _params.min_factor : err > T(0) ? _params.safety / std::sqrt(err) : _params.max_factor;
+			const T dt_next = dt * std::min(_params.max_factor, std::max(_params.min_factor, factor));
+			if (accepted) {
+				_stat.accepted++;
+			} else {
+				_stat.rejected++;
+				_stat.failed += failed;
+				point.load_state(_start.data());
+			}
+			dt = std::min(_params.dt_max, std::max(_params.dt_min, dt_next));
+			return accepted;
+		}
+
+		// subcycles the point up to the time t_end, dt is the proposed step (updated)
+		// returns the status of a step failed at dt_min (the point stays at the beginning of that step) or OK
+		step_status advance(MaterialPoint<T, 3>& point, T t_end, T& dt) {
+			const T eps = std::numeric_limits<T>::epsilon() * std::max(T(1), std::fabs(t_end)) * T(16);
+			while (point.t() < t_end - eps) {
+				const bool last = !(dt < t_end - point.t());
+				T dt_try = last ? t_end - point.t() : dt;
+				const bool at_min = dt_try <= _params.dt_min;
+				const bool accepted = try_step(point, dt_try);
+				if (!accepted && _status != step_status::OK && at_min) {
+					return _status;
+				}
+				// the shortened last step should not decrease the proposed step
+				dt = (accepted && last) ? std::max(dt, dt_try) : dt_try;
+			}
+			return step_status::OK;
+		}
+	};
+
+	/*
+		Advances a batch of points to a global synchronization time, each point is subcycled
+		with its own dt; points are distributed over threads with own steppers
+		a point failed at dt_min stays at the time of its failure with its status, other points are not stopped
+	*/
+	template<typename T>
+	class AdaptiveDriver {
+		AdaptiveParams<T> _params;
+		std::vector<T> _dt; // proposed step of each point
+		std::vector<step_status> _status;
+		AdaptiveStatistics _stat;
+
+	public:
+		AdaptiveDriver(size_t points, T dt_init, const AdaptiveParams<T>& params = AdaptiveParams<T>()) :
+			_params(params),
+			_dt(points, dt_init),
+			_status(points, step_status::OK) {};
+
+		const std::vector<T>& dt() const { return _dt; };
+		// statuses of points at the last sync
+		const std::vector<step_status>& status() const { return _status; };
+		const AdaptiveStatistics& statistics() const { return _stat; };
+
+		// returns the number of failed points
+		template<class Point>
+		size_t sync(const std::vector<std::shared_ptr<Point>>& points, T t_sync, size_t threads = 1) {
+			std::vector<AdaptiveStepper<T>> steppers(model::thread_count(points.size(), threads), AdaptiveStepper<T>(_params));
+			std::exception_ptr error;
+			try {
+				model::parallel(points.size(), threads, [&](size_t begin, size_t end, size_t thread_idx) {
+					for (size_t i = begin; i < end; ++i) {
+						_status[i] = steppers[thread_idx].advance(*points[i], t_sync, _dt[i]);
+					}
+				});
+			} catch (...) {
+				error = std::current_exception();
+			}
+			for (const auto& stepper : steppers) {
+				_stat += stepper.statistics();
+			}
+			if (error) std::rethrow_exception(error);
+			size_t failed = 0;
+			for (const auto status : _status) {
+				failed += status == step_status::OK ? 0 : 1;
+			}
+			return failed;
+		}
+	};
+};
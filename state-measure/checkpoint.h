@@ -0,0 +1,205 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "../state-measure/mapped_file.h"
+#include "../state-measure/state.h"
+
+namespace state {
+	namespace error {
+		class WrongCheckpoint : public std::exception {
+			std::string _msg;
+		public:
+			WrongCheckpoint(const std::string& path, const std::string& reason) :
+				_msg("Wrong checkpoint file: " + path + " \n Reason: " + reason) {};
+			virtual const char* what() const noexcept {
+				return _msg.c_str();
+			};
+		};
+	}
+
+	constexpr char CHECKPOINT_MAGIC[4] = { 'T', 'M', 'C', 'P' };
+	constexpr uint32_t CHECKPOINT_VERSION = 2;
+
+	struct CheckpointHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t scalar_size;
+		uint32_t slot;         // slot of the last completed pass
+		uint64_t point_count;
+		uint64_t point_size;   // number of T in the packed state of a point (see MaterialPoint::save_state)
+		uint64_t passes;       // number of completed passes over all points
+		uint64_t next_point;   // the first point of the next incremental write
+	};
+
+	/*
+		Checkpoint of a batch of material points in one contiguous memory-mapped file, two slots of states
+		layout: CheckpointHeader | slot 0: state of point 0 | state of point 1 | ... | slot 1: ...
+		(packed states of all points have the same size and start at 64 bytes aligned offsets)
+
+		- the first write_next() of a pass copies states of all points into the slot being written (a snapshot of one step,
+		  memory copies only), every call schedules asynchronous write back of the next chunk of the slot,
+		  so the output of a pass is spread over several steps and no call waits for the disk
+		- after the last chunk the slot becomes the slot of the last completed pass, the next pass is written into the other slot
+		- sync() waits until the file is written: a completed pass is durable after sync() (a crash before it
+		  may leave the header of the pass without its states), call it at the end of a run or every few passes
+		- restore() copies packed states of the last completed pass into points (all of them are of the same step),
+		  there is no deserialization per field, a checkpoint without completed passes is refused
+	*/
+	template<typename T>
+	class Checkpoint {
+		io::MappedFile _file;
+		CheckpointHeader* _header;
+		size_t _stride;
+		bool _snapshot = false; // the slot being written holds the snapshot of this object
+
+		static size_t stride(size_t point_size) {
+			return (point_size * sizeof(T) + 63) / 64 * 64;
+		}
+
+		static size_t data_offset() {
+			return (sizeof(CheckpointHeader) + 63) / 64 * 64;
+		}
+
+		static size_t file_size(size_t point_count, size_t point_size) {
+			return data_offset() + 2 * point_count * stride(point_size);
+		}
+
+		// slot written by the current pass
+		size_t writing_slot() const {
+			return _header->passes == 0 ? 0 : 1 - _header->slot;
+		}
+
+		size_t slot_offset(size_t slot, size_t idx) const {
+			return data_offset() + (slot * _header->point_count + idx) * _stride;
+		}
+
+		// states of all points into the slot being written, the pass starts from the first point
+		template<class Point>
+		void snapshot(const std::vector<std::shared_ptr<Point>>& points) {
+			const size_t slot = writing_slot();
+			for (size_t idx = 0; idx < points.size(); ++idx) {
+				points[idx]->save_state(reinterpret_cast<T*>(_file.data() + slot_offset(slot, idx)));
+			}
+			_header->next_point = 0;
+			_snapshot = true;
+		}
+
+		void complete_pass() {
+			_header->slot = static_cast<uint32_t>(writing_slot());
+			_header->next_point = 0;
+			_header->passes++;
+			_file.flush(0, sizeof(CheckpointHeader));
+			_snapshot = false;
+		}
+
+		Checkpoint(io::MappedFile&& file) :
+			_file(std::move(file)),
+			_header(reinterpret_cast<CheckpointHeader*>(_file.data())),
+			_stride(stride(_header->point_size)) {};
+
+		template<class Point>
+		void check_points(const std::vector<std::shared_ptr<Point>>& points) const {
+			if (points.size() != _header->point_count) {
+				throw error::WrongCheckpoint(_file.path(), "wrong number of points");
+			}
+			for (const auto& point : points) {
+				if (point->state_size() != _header->point_size) {
+					throw error::WrongCheckpoint(_file.path(), "wrong state size of a point");
+				}
+			}
+		}
+
+	public:
+		// creates a new checkpoint file for the batch of points
+		template<class Point>
+		static Checkpoint create(const std::string& path, const std::vector<std::shared_ptr<Point>>& points) {
+			const size_t point_size = points.empty() ? 0 : points.front()->state_size();
+			auto file = io::MappedFile::create(path, file_size(points.size(), point_size));
+			CheckpointHeader header{};
+			std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+			header.version = CHECKPOINT_VERSION;
+			header.scalar_size = sizeof(T);
+			header.point_count = points.size();
+			header.point_size = point_size;
+			std::memcpy(file.data(), &header, sizeof(CheckpointHeader));
+			Checkpoint checkpoint(std::move(file));
+			checkpoint.check_points(points);
+			return checkpoint;
+		}
+
+		// opens an existing checkpoint to restart from it (and to continue writing)
+		static Checkpoint open(const std::string& path) {
+			io::MappedFile file(path, true);
+			const auto header = reinterpret_cast<const CheckpointHeader*>(file.data());
+			if (file.size() < sizeof(CheckpointHeader) || std::memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+				throw error::WrongCheckpoint(path, "wrong magic");
+			}
+			if (header->version != CHECKPOINT_VERSION || header->scalar_size != sizeof(T)) {
+				throw error::WrongCheckpoint(path, "unsupported version or scalar type");
+			}
+			const uint64_t count = header->point_count;
+			const bool overflow = header->point_size > SIZE_MAX / sizeof(T) / 4
+				|| (count != 0 && stride(header->point_size) > (SIZE_MAX - data_offset()) / 2 / count);
+			if (overflow || file.size() < file_size(count, header->point_size) || header->slot > 1) {
+				throw error::WrongCheckpoint(path, "file is truncated");
+			}
+			return Checkpoint(std::move(file));
+		}
+
+		const CheckpointHeader& header() const { return *_header; };
+		size_t passes() const { return _header->passes; };
+
+		// packed state of the point idx of the last completed pass inside the mapping
+		const T* point_data(size_t idx) const {
+			return reinterpret_cast<const T*>(_file.data() + slot_offset(_header->slot, idx));
+		}
+
+		// incremental write: a pass starts with the snapshot of all points (a pass of another object is restarted),
+		// every call schedules write back of the next chunk of points, returns true when the pass is completed
+		template<class Point>
+		bool write_next(const std::vector<std::shared_ptr<Point>>& points, size_t chunk) {
+			check_points(points);
+			if (!_snapshot) {
+				snapshot(points);
+			}
+			const size_t begin = _header->next_point;
+			const size_t end = std::min<size_t>(begin + std::max<size_t>(chunk, 1), _header->point_count);
+			if (end > begin) {
+				_file.flush(slot_offset(writing_slot(), begin), (end - begin) * _stride);
+			}
+			const bool completed = end == _header->point_count;
+			if (completed) {
+				complete_pass();
+			} else {
+				_header->next_point = end;
+			}
+			return completed;
+		}
+
+		// full checkpoint in one call (a pass in progress is restarted)
+		template<class Point>
+		void write(const std::vector<std::shared_ptr<Point>>& points) {
+			check_points(points);
+			snapshot(points);
+			_file.flush(slot_offset(writing_slot(), 0), points.size() * _stride);
+			complete_pass();
+		}
+
+		// restores states of points (created with the same model and params) of the last completed pass
+		template<class Point>
+		void restore(const std::vector<std::shared_ptr<Point>>& points) const {
+			check_points(points);
+			if (_header->passes == 0) {
+				throw error::WrongCheckpoint(_file.path(), "no completed pass");
+			}
+			for (size_t idx = 0; idx < points.size(); ++idx) {
+				points[idx]->load_state(point_data(idx));
+			}
+		}
+
+		// waits until all written states and the header of the last completed pass are in the file
+		void sync() {
+			_file.flush(false);
+		}
+	};
+};
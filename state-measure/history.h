@@ -0,0 +1,320 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "../state-measure/state.h"
+
+namespace state {
+	namespace error {
+		class HistoryStarted : public std::exception {
+		public:
+			virtual const char* what() const noexcept {
+				return "History: columns can not be added after the first record";
+			};
+		};
+
+		class WrongHistory : public std::exception {
+			std::string _msg;
+		public:
+			WrongHistory(const std::string& path, const std::string& reason) :
+				_msg("Wrong history file: " + path + " \n Reason: " + reason) {};
+			virtual const char* what() const noexcept {
+				return _msg.c_str();
+			};
+		};
+	}
+
+	enum class history_field {
+		VALUE,
+		RATE,
+		VALUE_INTENSITY,
+		RATE_INTENSITY
+	};
+
+	constexpr char HISTORY_MAGIC[4] = { 'T', 'M', 'H', 'S' };
+	constexpr uint32_t HISTORY_VERSION = 1;
+
+	/*
+		Time history of selected measures in columnar binary format
+		file layout (native endianness):
+			magic | version | scalar size | columns count
+			for each column: width (uint32) | name length (uint32) | name ("point/measure/field")
+			blocks: rows (uint64) | t[rows] | for each column, for each component: values[rows]
+
+		the stepping thread only copies the selected buffers into the active block (record),
+		a full block is swapped with the spare one and written (transposed to columns) by the background thread
+	*/
+	template<typename T>
+	class HistoryWriter {
+		struct Column {
+			std::shared_ptr<const BaseMeasure<T>> measure;
+			history_field field;
+			size_t width;
+			std::string name;
+		};
+
+		std::vector<Column> _columns;
+		size_t _row_size = 1; // t + widths of all columns
+		const size_t _block_rows;
+		const size_t _decimation;
+		size_t _calls = 0;
+		bool _started = false;
+
+		std::vector<T> _active;
+		std::vector<T> _spare;
+		size_t _active_rows = 0;
+		size_t _spare_rows = 0;
+		bool _spare_pending = false;
+		bool _stop = false;
+
+		const std::string _path;
+		std::ofstream _file;
+		std::vector<T> _columnar; // transposed block, used by the writer thread only
+		std::mutex _mutex;
+		std::condition_variable _cv;
+		std::thread _writer;
+
+		void write_header() {
+			const uint32_t header[3] = { HISTORY_VERSION, static_cast<uint32_t>(sizeof(T)), static_cast<uint32_t>(_columns.size()) };
+			_file.write(HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+			_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+			for (const auto& column : _columns) {
+				const uint32_t desc[2] = { static_cast<uint32_t>(column.width), static_cast<uint32_t>(column.name.size()) };
+				_file.write(reinterpret_cast<const char*>(desc), sizeof(desc));
+				_file.write(column.name.data(), column.name.size());
+			}
+		}
+
+		void write_block(const std::vector<T>& block, size_t rows) {
+			_columnar.resize(rows * _row_size);
+			for (size_t row = 0; row < rows; ++row) {
+				for (size_t col = 0; col < _row_size; ++col) {
+					_columnar[col * rows + row] = block[row * _row_size + col];
+				}
+			}
+			const uint64_t count = rows;
+			_file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+			_file.write(reinterpret_cast<const char*>(_columnar.data()), _columnar.size() * sizeof(T));
+		}
+
+		void writer_loop() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (true) {
+				_cv.wait(lock, [this] { return _spare_pending || _stop; });
+				if (_spare_pending) {
+					lock.unlock();
+					write_block(_spare, _spare_rows);
+					lock.lock();
+					_spare_pending = false;
+					_cv.notify_all();
+				} else if (_stop) {
+					break;
+				}
+			}
+			_file.flush();
+		}
+
+		void start() {
+			_started = true;
+			_active.resize(_block_rows * _row_size);
+			_spare.resize(_block_rows * _row_size);
+			write_header();
+			_writer = std::thread(&HistoryWriter::writer_loop, this);
+		}
+
+		// hands the active block over to the writer thread (waits if the previous one is still being written)
+		void swap_blocks() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [this] { return !_spare_pending; });
+			std::swap(_active, _spare);
+			_spare_rows = _active_rows;
+			_active_rows = 0;
+			_spare_pending = true;
+			_cv.notify_all();
+		}
+
+	public:
+		// records every decimation-th call of record(), block_rows rows per block
+		HistoryWriter(const std::string& path, size_t decimation = 1, size_t block_rows = 1024) :
+			_block_rows(std::max<size_t>(block_rows, 1)),
+			_decimation(std::max<size_t>(decimation, 1)),
+			_path(path),
+			_file(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!_file.is_open()) {
+				throw std::ios_base::failure("Failed to open file: " + path);
+			}
+		};
+
+		HistoryWriter(const HistoryWriter&) = delete;
+		HistoryWriter& operator= (const HistoryWriter&) = delete;
+
+		// errors of writing are reported by close() only
+		~HistoryWriter() {
+			try {
+				close();
+			} catch (const std::exception&) {}
+		}
+
+		// adds a column of the measure of the point
+		void add(const MaterialPoint<T, 3>& point, const std::string& measure_name, history_field field, const std::string& point_name = "") {
+			if (_started) {
+				throw error::HistoryStarted();
+			}
+			for (const auto& measure : point.measures()) {
+				if (measure->name() == measure_name) {
+					const size_t width = (field == history_field::VALUE || field == history_field::RATE) ? measure->comp_size() : 1;
+					const char* field_name[] = { "value", "rate", "value_intensity", "rate_intensity" };
+					_columns.push_back({ measure, field, width, point_name + "/" + measure_name + "/" + field_name[static_cast<size_t>(field)] });
+					_row_size += width;
+					return;
+				}
+			}
+			throw ErrorAccess::NotExists();
+		}
+
+		// adds columns of the field for all measures of the point
+		void add(const MaterialPoint<T, 3>& point, history_field field, const std::string& point_name = "") {
+			for (const auto& measure : point.measures()) {
+				add(point, measure->name(), field, point_name);
+			}
+		}
+
+		// called from the stepping loop, copies selected buffers into the active block
+		void record(T t) {
+			if (_calls++ % _decimation) {
+				return;
+			}
+			if (!_started) {
+				start();
+			}
+			T* row = _active.data() + _active_rows * _row_size;
+			*row++ = t;
+			for (const auto& column : _columns) {
+				switch (column.field)
+				{
+				case history_field::VALUE:
+					memcpy(row, column.measure->value_data(), column.width * sizeof(T));
+					break;
+				case history_field::RATE:
+					memcpy(row, column.measure->rate_data(), column.width * sizeof(T));
+					break;
+				case history_field::VALUE_INTENSITY:
+					*row = column.measure->value_intensity();
+					break;
+				case history_field::RATE_INTENSITY:
+					*row = column.measure->rate_intensity();
+					break;
+				default:
+					break;
+				}
+				row += column.width;
+			}
+			if (++_active_rows == _block_rows) {
+				swap_blocks();
+			}
+		}
+
+		// writes recorded rows (the header only if nothing was recorded), stops the writer thread and closes the file
+		void close() {
+			if (!_file.is_open()) {
+				return;
+			}
+			if (!_started) {
+				_started = true;
+				write_header();
+			}
+			if (_writer.joinable()) {
+				if (_active_rows) {
+					swap_blocks();
+				}
+				{
+					std::unique_lock<std::mutex> lock(_mutex);
+					_cv.wait(lock, [this] { return !_spare_pending; });
+					_stop = true;
+					_cv.notify_all();
+				}
+				_writer.join();
+			}
+			_file.close();
+			if (_file.fail()) {
+				throw std::ios_base::failure("History: failed to write file: " + _path);
+			}
+		}
+	};
+
+	/*
+		History file read back into memory: names and widths of columns, times and values of columns
+		(values of the column c at row r: columns[c][r * widths[c] + comp])
+	*/
+	template<typename T>
+	struct History {
+		std::vector<std::string> names;
+		std::vector<size_t> widths;
+		std::vector<T> t;
+		std::vector<std::vector<T>> columns;
+
+		size_t rows() const { return t.size(); };
+
+		static History read(const std::string& path) {
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open()) {
+				throw std::ios_base::failure("Failed to open file: " + path);
+			}
+			const auto read_raw = [&](void* dst, size_t size) {
+				if (!file.read(reinterpret_cast<char*>(dst), size)) {
+					throw error::WrongHistory(path, "file is truncated");
+				}
+			};
+			char magic[4];
+			uint32_t header[3];
+			read_raw(magic, sizeof(magic));
+			if (std::memcmp(magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) != 0) {
+				throw error::WrongHistory(path, "wrong magic");
+			}
+			read_raw(header, sizeof(header));
+			if (header[0] != HISTORY_VERSION || header[1] != sizeof(T)) {
+				throw error::WrongHistory(path, "unsupported version or scalar type");
+			}
+			History result;
+			for (uint32_t c = 0; c < header[2]; ++c) {
+				uint32_t desc[2];
+				read_raw(desc, sizeof(desc));
+				std::string name(desc[1], '\0');
+				read_raw(name.data(), name.size());
+				result.names.push_back(std::move(name));
+				result.widths.push_back(desc[0]);
+			}
+			result.columns.resize(result.widths.size());
+			uint64_t rows;
+			std::vector<T> block;
+			while (file.read(reinterpret_cast<char*>(&rows), sizeof(rows))) {
+				const size_t row_size = 1 + std::accumulate(result.widths.begin(), result.widths.end(), size_t(0));
+				block.resize(rows * row_size);
+				read_raw(block.data(), block.size() * sizeof(T));
+				result.t.insert(result.t.end(), block.begin(), block.begin() + rows);
+				size_t offset = rows;
+				for (size_t c = 0; c < result.columns.size(); ++c) {
+					auto& column = result.columns[c];
+					const size_t first = column.size();
+					column.resize(first + rows * result.widths[c]);
+					// columnar block: component j of the column over rows
+					for (size_t j = 0; j < result.widths[c]; ++j, offset += rows) {
+						for (size_t r = 0; r < rows; ++r) {
+							column[first + r * result.widths[c] + j] = block[offset + r];
+						}
+					}
+				}
+			}
+			if (!file.eof() || file.gcount() != 0) {
+				throw error::WrongHistory(path, "file is truncated");
+			}
+			return result;
+		}
+	};
+};
\ No newline at end of file
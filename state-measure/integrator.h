@@ -0,0 +1,333 @@
+#pragma once
+#include <array>
+#include <vector>
+#include "../state-measure/state.h"
+
+namespace numerical_schema {
+	using namespace state;
+
+	namespace error {
+		class RateSchemaRequired : public std::exception {
+		public:
+			virtual const char* what() const noexcept {
+				return "Runge-Kutta integrator requires RATE_CALCULATE numerical schema of the point";
+			};
+		};
+
+		class NotConverged : public std::exception {
+		public:
+			virtual const char* what() const noexcept {
+				return "BDF-2 integrator: iterations of the implicit step did not converge";
+			};
+		};
+
+		// a step of the point evaluating a stage (iteration) failed, the point is restored to t_n
+		class StepFailed : public std::exception {
+			step_status _status;
+			std::string _msg;
+		public:
+			StepFailed(step_status status) :
+				_status(status), _msg(std::string("Integrator: a step of the point failed: ") + to_string(status)) {};
+			step_status status() const { return _status; };
+			virtual const char* what() const noexcept {
+				return _msg.c_str();
+			};
+		};
+	}
+
+	// values and internal variables of all measures of a point packed one after another (stages and iterations of integrators)
+	namespace packed {
+		template<typename T>
+		size_t values_size(const MaterialPoint<T, 3>& point) {
+			size_t size = 0;
+			for (const auto& measure : point.measures()) {
+				size += measure->comp_size() + measure->internal_size();
+			}
+			return size;
+		}
+
+		// k = 0 current values, k < 0 previous ones (see BaseMeasure::value_data_at)
+		template<typename T>
+		void gather(const MaterialPoint<T, 3>& point, T* values, int k = 0) {
+			for (const auto& measure : point.measures()) {
+				memcpy(values, measure->value_data_at(k), measure->comp_size() * sizeof(T));
+				values += measure->comp_size();
+				measure->internal_at(k, values);
+				values += measure->internal_size();
+			}
+		}
+
+		// time derivatives of values and rates evaluated by the last step of the point,
+		// the rate of an internal variable is its derivative
+		template<typename T>
+		void gather_rates(const MaterialPoint<T, 3>& point, const T* values, T* derivatives, T* rates) {
+			for (const auto& measure : point.measures()) {
+				const size_t size = measure->comp_size(), internal = measure->internal_size();
+				measure->value_derivative(values, derivatives);
+				memcpy(rates, measure->rate_data(), size * sizeof(T));
+				measure->internal_derivative(derivatives + size);
+				memcpy(rates + size, derivatives + size, internal * sizeof(T));
+				values += size + internal;
+				derivatives += size + internal;
+				rates += size + internal;
+			}
+		}
+
+		template<typename T>
+		void scatter(MaterialPoint<T, 3>& point, const T* values, T t) {
+			for (const auto& measure : point.measures()) {
+				measure->assign_value(values);
+				measure->assign_internal(values + measure->comp_size());
+				measure->set_time(t);
+				values += measure->comp_size() + measure->internal_size();
+			}
+		}
+
+		template<typename T>
+		void commit(MaterialPoint<T, 3>& point, const T* values, const T* rates, T t) {
+			for (const auto& measure : point.measures()) {
+				const size_t size = measure->comp_size();
+				measure->commit(values, rates);
+				measure->commit_internal(values + size, rates + size);
+				measure->set_time(t);
+				values += size + measure->internal_size();
+				rates += size + measure->internal_size();
+			}
+		}
+	}
+
+	// non-throwing step of the point at a stage, a failure restores the point to the start of the integrator step
+	template<typename T>
+	void stage_step(MaterialPoint<T, 3>& point, T dt, const std::vector<T>& start) {
+		const auto status = point.try_step(dt);
+		if (status != step_status::OK) {
+			point.load_state(start.data());
+			throw error::StepFailed(status);
+		}
+	}
+
+	/*
+		Butcher tableaux of explicit Runge-Kutta methods
+		a - lower triangular stages x stages (row-major), b - weights, c - nodes
+	*/
+	namespace method {
+		struct Euler {
+			static constexpr size_t stages = 1;
+			static constexpr size_t order = 1;
+			static constexpr std::array<double, 1> a = { 0 };
+			static constexpr std::array<double, 1> b = { 1 };
+			static constexpr std::array<double, 1> c = { 0 };
+		};
+
+		struct Heun {
+			static constexpr size_t stages = 2;
+			static constexpr size_t order = 2;
+			static constexpr std::array<double, 4> a = {
+				0, 0,
+				1, 0 };
+			static constexpr std::array<double, 2> b = { 0.5, 0.5 };
+			static constexpr std::array<double, 2> c = { 0, 1 };
+		};
+
+		// strong stability preserving RK3 (Shu-Osher)
+		struct SSPRK3 {
+			static constexpr size_t stages = 3;
+			static constexpr size_t order = 3;
+			static constexpr std::array<double, 9> a = {
+				0,    0,    0,
+				1,    0,    0,
+				0.25, 0.25, 0 };
+			static constexpr std::array<double, 3> b = { 1.0 / 6, 1.0 / 6, 2.0 / 3 };
+			static constexpr std::array<double, 3> c = { 0, 1, 0.5 };
+		};
+
+		// classic RK4
+		struct RK4 {
+			static constexpr size_t stages = 4;
+			static constexpr size_t order = 4;
+			static constexpr std::array<double, 16> a = {
+				0,   0,   0, 0,
+				0.5, 0,   0, 0,
+				0,   0.5, 0, 0,
+				0,   0,   1, 0 };
+			static constexpr std::array<double, 4> b = { 1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6 };
+			static constexpr std::array<double, 4> c = { 0, 0.5, 0.5, 1 };
+		};
+	}
+
+	/*
+		Explicit Runge-Kutta step of a material point, stages are coordinated over all measures of the point:
+			Y_i = y_n + dt * sum(a_ij * k_j), k_i = dX/dt(Y_i, r_i)
+		rates r_i of the stage are evaluated by the own step of the point from Y_i at t_n + c_i*dt,
+		so dependencies between measures (relations) are evaluated in the order of the model at every stage,
+		dX/dt is given by the measure (see BaseMeasure::value_derivative, e.g. L.F for deformation gradient),
+		internal variables of measures (e.g. slip resistances) are integrated by the same stages (see BaseMeasure::internal_size).
+		The result y_n+1 = y_n + dt * sum(b_i * k_i) and the rate sum(b_i * r_i) are accepted by measures
+		through value_temp/rate_temp (see BaseMeasure::commit), stage buffers are allocated once per integrator.
+		A failed step of a stage restores the point to t_n and throws error::StepFailed with the status of the step.
+	*/
+	template<typename T, class Method>
+	class ExplicitRK {
+		std::vector<T> _start;  // packed state at t_n
+		std::vector<T> _y0;     // values of all measures at t_n
+		std::vector<T> _stage;  // values of all measures at the current stage
+		std::vector<T> _k;      // stages x derivatives of values
+		std::vector<T> _r;      // stages x rates
+
+		void resize(const MaterialPoint<T, 3>& point) {
+			const size_t size = packed::values_size(point);
+			_start.resize(point.state_size());
+			_y0.resize(size);
+			_stage.resize(size);
+			_k.resize(size * Method::stages);
+			_r.resize(size * Method::stages);
+		}
+
+	public:
+		static constexpr size_t stages = Method::stages;
+		static constexpr size_t order = Method::order;
+
+		void step(MaterialPoint<T, 3>& point, T dt) {
+			if (point.numerical_schema_type() != measure::type_schema::RATE_CALCULATE) {
+				throw error::RateSchemaRequired();
+			}
+			resize(point);
+			const size_t size = _y0.size();
+			const T t0 = point.t();
+			point.save_state(_start.data());
+			packed::gather(point, _y0.data());
+
+			for (size_t i = 0; i < Method::stages; ++i) {
+				T* k = _k.data() + i * size;
+				_stage = _y0;
+				for (size_t j = 0; j < i; ++j) {
+					const T a = T(Method::a[i * Method::stages + j]) * dt;
+					if (a == T(0)) continue;
+					const T* kj = _k.data() + j * size;
+					for (size_t idx = 0; idx < size; ++idx) {
+						_stage[idx] += a * kj[idx];
+					}
+				}
+				if (i > 0) {
+					point.load_state(_start.data());
+					packed::scatter(point, _stage.data(), t0 + T(Method::c[i]) * dt);
+				}
+				stage_step(point, dt, _start);
+				packed::gather_rates(point, _stage.data(), k, _r.data() + i * size);
+			}
+
+			// _y0 := y_n + dt * sum(b_i * k_i), _stage := sum(b_i * r_i)
+			std::fill(_stage.begin(), _stage.end(), T(0));
+			for (size_t i = 0; i < Method::stages; ++i) {
+				const T b = T(Method::b[i]);
+				const T* k = _k.data() + i * size;
+				const T* r = _r.data() + i * size;
+				for (size_t idx = 0; idx < size; ++idx) {
+					_y0[idx] += b * dt * k[idx];
+					_stage[idx] += b * r[idx];
+				}
+			}
+
+			point.load_state(_start.data());
+			packed::commit(point, _y0.data(), _stage.data(), t0 + dt);
+			point.inc_time(dt);
+		}
+	};
+
+	/*
+		Implicit variable step BDF-2 step of a material point (RATE_CALCULATE schema):
+			y_n+1 = a0 * y_n + a1 * y_n-1 + b * dt * f(y_n+1), w = dt / dt_prev
+			a0 = (1 + w)^2 / (1 + 2w), a1 = -w^2 / (1 + 2w), b = (1 + w) / (1 + 2w)
+		y_n-1 is the previous value of measures (value_at(-1) of the history), dt_prev is the previous step of the integrator,
+		so an integrator keeps the history of one point; the first step is backward Euler (a0 = 1, a1 = 0, b = 1)
+		the implicit equation is solved by fixed point iterations: f(Y) is evaluated by the own step of the point from Y
+		at t_n+1 (as stages of ExplicitRK), iterations converge for b * dt * |df/dy| < 1
+		a failed step of an iteration restores the point to t_n and throws error::StepFailed
+	*/
+	template<typename T>
+	class BDF2Integrator {
+		T _tolerance;
+		size_t _max_iterations;
+		T _dt_prev = 0;
+		size_t _iterations = 0;
+		std::vector<T> _start; // packed state at t_n
+		std::vector<T> _rhs;   // a0 * y_n + a1 * y_n-1
+		std::vector<T> _prev;  // y_n-1
+		std::vector<T> _y;     // iterate
+		std::vector<T> _k;     // derivatives of values at the iterate
+		std::vector<T> _r;     // rates at the iterate
+
+		void resize(const MaterialPoint<T, 3>& point) {
+			const size_t size = packed::values_size(point);
+			_start.resize(point.state_size());
+			_rhs.resize(size);
+			_prev.resize(size);
+			_y.resize(size);
+			_k.resize(size);
+			_r.resize(size);
+		}
+
+	public:
+		static constexpr size_t order = 2;
+
+		// relative tolerance of the change of values between iterations
+		BDF2Integrator(T tolerance = T(1e-10), size_t max_iterations = 50) :
+			_tolerance(tolerance), _max_iterations(max_iterations) {};
+
+		// iterations of the last step
+		size_t iterations() const { return _iterations; };
+
+		// the next step is backward Euler (e.g. after a restart of the point from a checkpoint)
+		void reset() { _dt_prev = T(0); };
+
+		void step(MaterialPoint<T, 3>& point, T dt) {
+			if (point.numerical_schema_type() != measure::type_schema::RATE_CALCULATE) {
+				throw error::RateSchemaRequired();
+			}
+			resize(point);
+			const size_t size = _y.size();
+			const T t0 = point.t();
+			T a0 = T(1), a1 = T(0), b = T(1);
+			if (_dt_prev > T(0)) {
+				const T w = dt / _dt_prev;
+				a0 = (T(1) + w) * (T(1) + w) / (T(1) + T(2) * w);
+				a1 = -w * w / (T(1) + T(2) * w);
+				b = (T(1) + w) / (T(1) + T(2) * w);
+			}
+			point.save_state(_start.data());
+			packed::gather(point, _y.data());
+			packed::gather(point, _prev.data(), -1);
+			for (size_t idx = 0; idx < size; ++idx) {
+				_rhs[idx] = a0 * _y[idx] + a1 * _prev[idx];
+			}
+
+			bool converged = false;
+			for (_iterations = 1; _iterations <= _max_iterations && !converged; ++_iterations) {
+				point.load_state(_start.data());
+				packed::scatter(point, _y.data(), t0 + dt);
+				stage_step(point, dt, _start);
+				packed::gather_rates(point, _y.data(), _k.data(), _r.data());
+				converged = true;
+				for (size_t idx = 0; idx < size; ++idx) {
+					const T y = _rhs[idx] + b * dt * _k[idx];
+					converged = converged && std::abs(y - _y[idx]) <= _tolerance * (T(1) + std::abs(y));
+					_y[idx] = y;
+				}
+			}
+			if (!converged) {
+				point.load_state(_start.data());
+				throw error::NotConverged();
+			}
+			_iterations--;
+
+			point.load_state(_start.data());
+			packed::commit(point, _y.data(), _r.data(), t0 + dt);
+			point.inc_time(dt);
+			_dt_prev = dt;
+		}
+	};
+
+	template<typename T> using HeunIntegrator = ExplicitRK<T, method::Heun>;
+	template<typename T> using SSPRK3Integrator = ExplicitRK<T, method::SSPRK3>;
+	template<typename T> using RK4Integrator = ExplicitRK<T, method::RK4>;
+};
@@ -0,0 +1,342 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "../state-measure/mapped_file.h"
+#include "../state-measure/state.h"
+
+namespace measure {
+	namespace strain {
+		namespace loading {
+			namespace error {
+				class WrongProgram : public std::exception {
+					std::string _msg;
+				public:
+					WrongProgram(const std::string& path, const std::string& reason) :
+						_msg("Wrong loading program: " + path + " \n Reason: " + reason) {};
+					virtual const char* what() const noexcept {
+						return _msg.c_str();
+					};
+				};
+			}
+
+			constexpr char PROGRAM_MAGIC[4] = { 'T', 'M', 'L', 'P' };
+			constexpr uint32_t PROGRAM_VERSION = 1;
+
+			// tabulated quantity of a program
+			enum class program_kind : uint32_t {
+				RATE,  // velocity gradient L(t)
+				VALUE  // deformation gradient F(t)
+			};
+
+			struct ProgramHeader {
+				char magic[4];
+				uint32_t version;
+				uint32_t scalar_size;  // sizeof(double)
+				program_kind kind;
+				uint64_t path_count;   // 1 - one path for all points, else a path per point
+				uint64_t sample_count; // samples of every path
+				uint64_t file_size;
+			};
+
+			// time and components of L or F (container layout { 00, 11, 22, 12, 02, 01, 21, 20, 10 })
+			struct ProgramSample {
+				double t;
+				double comp[9];
+			};
+
+			/*
+				Memory-mapped loading program: tabulated L(t) or F(t) of one or many paths
+				layout (native endianness): ProgramHeader | samples of path 0 | samples of path 1 | ...
+				(paths start at 64 bytes aligned offsets, times of samples of a path are increasing)
+				samples are read from the mapping on demand, only touched pages of the history are loaded into memory,
+				the mapping is read-only, so one file serves paths of all points of all threads
+			*/
+			class ProgramFile {
+				io::MappedFile _file;
+				const ProgramHeader* _header;
+
+				static size_t data_offset() {
+					return (sizeof(ProgramHeader) + 63) / 64 * 64;
+				}
+
+				static size_t path_stride(size_t sample_count) {
+					return (sample_count * sizeof(ProgramSample) + 63) / 64 * 64;
+				}
+
+				explicit ProgramFile(io::MappedFile&& file) :
+					_file(std::move(file)),
+					_header(reinterpret_cast<const ProgramHeader*>(_file.data())) {};
+
+				void validate() const {
+					const auto& path = _file.path();
+					if (_file.size() < sizeof(ProgramHeader) || std::memcmp(_header->magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC)) != 0) {
+						throw error::WrongProgram(path, "wrong magic");
+					}
+					if (_header->version != PROGRAM_VERSION) {
+						throw error::WrongProgram(path, "unsupported version " + std::to_string(_header->version));
+					}
+					if (_header->scalar_size != sizeof(double)) {
+						throw error::WrongProgram(path, "unsupported scalar size " + std::to_string(_header->scalar_size));
+					}
+					if (_header->path_count == 0 || _header->sample_count < 2) {
+						throw error::WrongProgram(path, "a program must contain at least one path of two samples");
+					}
+					if (!fits(_header->path_count, _header->sample_count) || _header->file_size != _file.size()
+						|| _file.size() < size(_header->path_count, _header->sample_count)) {
+						throw error::WrongProgram(path, "file is truncated");
+					}
+				}
+
+				// size of the file is representable by size_t
+				static bool fits(uint64_t path_count, uint64_t sample_count) {
+					const size_t max_stride = (SIZE_MAX - data_offset()) / std::max<uint64_t>(path_count, 1) / 64 * 64;
+					return sample_count <= max_stride / sizeof(ProgramSample);
+				}
+
+			public:
+				static size_t size(size_t path_count, size_t sample_count) {
+					if (!fits(path_count, sample_count)) {
+						throw std::length_error("Loading program: " + std::to_string(path_count) + " paths of " + std::to_string(sample_count) + " samples are too large");
+					}
+					return data_offset() + path_count * path_stride(sample_count);
+				}
+
+				/*
+					times are checked lazily by segments the paths reach (see Program::locate),
+					check_times scans all samples at open, so the whole history is loaded into memory
+				*/
+				static std::shared_ptr<const ProgramFile> open(const std::string& path, bool check_times = false) {
+					auto program = std::shared_ptr<ProgramFile>(new ProgramFile(io::MappedFile(path)));
+					program->validate();
+					if (check_times) {
+						for (size_t p = 0; p < program->path_count(); ++p) {
+							const ProgramSample* samples = program->samples(p);
+							for (size_t i = 1; i < program->sample_count(); ++i) {
+								program->check_segment(samples, i);
+							}
+						}
+					}
+					return program;
+				}
+
+				// the segment [idx - 1, idx] of samples of a path has increasing times
+				void check_segment(const ProgramSample* samples, size_t idx) const {
+					if (!(samples[idx].t > samples[idx - 1].t)) {
+						const auto offset = reinterpret_cast<const char*>(samples) - reinterpret_cast<const char*>(this->samples(0));
+						const size_t p = static_cast<size_t>(offset) / path_stride(sample_count());
+						throw error::WrongProgram(path(), "times of path " + std::to_string(p) + " are not increasing at sample " + std::to_string(idx));
+					}
+				}
+
+				program_kind kind() const { return _header->kind; };
+				size_t path_count() const { return _header->path_count; };
+				size_t sample_count() const { return _header->sample_count; };
+				const std::string& path() const { return _file.path(); };
+
+				const ProgramSample* samples(size_t path) const {
+					return reinterpret_cast<const ProgramSample*>(_file.data() + data_offset() + path * path_stride(sample_count()));
+				}
+
+				/*
+					Writer of a program file: samples are written into the mapping one by one,
+					so histories are not kept in memory (see convert_csv)
+				*/
+				class Writer {
+					io::MappedFile _file;
+					size_t _sample_count;
+				public:
+					Writer(const std::string& path, program_kind kind, size_t path_count, size_t sample_count) :
+						_file(io::MappedFile::create(path, ProgramFile::size(path_count, sample_count))),
+						_sample_count(sample_count)
+					{
+						ProgramHeader header{};
+						std::memcpy(header.magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC));
+						header.version = PROGRAM_VERSION;
+						header.scalar_size = sizeof(double);
+						header.kind = kind;
+						header.path_count = path_count;
+						header.sample_count = sample_count;
+						header.file_size = _file.size();
+						std::memcpy(_file.data(), &header, sizeof(header));
+					};
+
+					void write(size_t path, size_t idx, double t, const tens::M3x3<double>& X) {
+						ProgramSample sample{ t };
+						std::memcpy(sample.comp, X.data(), sizeof(sample.comp));
+						std::memcpy(_file.data() + data_offset() + path * path_stride(_sample_count) + idx * sizeof(ProgramSample), &sample, sizeof(sample));
+					}
+
+					void flush() { _file.flush(false); };
+				};
+
+				/*
+					CSV histories -> program file, a file per path, every file has the same number of rows:
+						t, X00, X01, X02, X10, X11, X12, X20, X21, X22
+					(a header line and lines starting with # are skipped), files are streamed line by line twice:
+					to count rows and to write samples
+				*/
+				static void convert_csv(const std::vector<std::string>& csv_files, const std::string& bin_file, program_kind kind) {
+					const auto for_rows = [](const std::string& csv, const auto& row) {
+						std::ifstream stream(csv);
+						if (!stream.is_open()) {
+							throw std::ios_base::failure("Failed to open file: " + csv);
+						}
+						std::string line;
+						std::array<double, 10> values;
+						while (std::getline(stream, line)) {
+							if (line.empty() || line[0] == '#') continue;
+							std::replace(line.begin(), line.end(), ',', ' ');
+							std::istringstream fields(line);
+							size_t count = 0;
+							while (count < values.size() && fields >> values[count]) ++count;
+							if (count == 0 && !fields.eof()) continue; // header
+							if (count != values.size()) {
+								throw error::WrongProgram(csv, "a row must contain t and 9 components: " + line);
+							}
+							row(values);
+						}
+					};
+					if (csv_files.empty()) {
+						throw std::invalid_argument("Loading program: no CSV files");
+					}
+					size_t sample_count = 0;
+					for_rows(csv_files.front(), [&](const std::array<double, 10>&) { sample_count++; });
+					Writer writer(bin_file, kind, csv_files.size(), sample_count);
+					tens::M3x3<double> X(tens::FILL_TYPE::ZERO);
+					for (size_t path = 0; path < csv_files.size(); ++path) {
+						size_t idx = 0;
+						for_rows(csv_files[path], [&](const std::array<double, 10>& values) {
+							if (idx == sample_count) {
+								throw error::WrongProgram(csv_files[path], "number of rows differs from " + csv_files.front());
+							}
+							for (size_t i = 0; i < 3; ++i) {
+								for (size_t j = 0; j < 3; ++j) {
+									X[math::dim3::IDX[i][j]] = values[1 + 3 * i + j];
+								}
+							}
+							writer.write(path, idx++, values[0], X);
+						});
+						if (idx != sample_count) {
+							throw error::WrongProgram(csv_files[path], "number of rows differs from " + csv_files.front());
+						}
+					}
+					writer.flush();
+				}
+			};
+
+			/*
+				Path of a point by a path of the program, linear interpolation in time between samples:
+					- program of L: rate(t) = L(t), value is not defined (the point must use RATE_CALCULATE)
+					- program of F: value(t) = F(t), rate(t) = dF/dt.F^-1 of the segment
+				the last located segment is kept as a hint, so sequential times cost O(1), other times are found by binary search
+				times of segments are checked when the path passes them (error::WrongProgram), a jump by the binary search
+				checks the segment it lands on
+				times out of the program throw std::out_of_range (see try_step)
+				rate/value use only local temporaries and the atomic hint, so one path is shared by points of all threads
+				(e.g. the macroscopic loading of Polycrystal), many paths view the same program file
+			*/
+			template<typename T>
+			class Program : public Path<T> {
+				std::shared_ptr<const ProgramFile> _file;
+				const ProgramSample* _samples;
+				mutable std::atomic<size_t> _hint{ 1 }; // the last located segment of any caller
+				static constexpr size_t MAX_WALK = 8; // segments passed one by one before the binary search
+
+				// segment of t (samples [segment - 1, segment]) and the weight of its right sample
+				T locate(T t, size_t& segment) const {
+					const size_t count = _file->sample_count();
+					if (t < T(_samples[0].t) || t > T(_samples[count - 1].t)) {
+						throw std::out_of_range("Loading program " + _file->path() + ": time " + std::to_string(t) + " is out of the program");
+					}
+					segment = _hint.load(std::memory_order_relaxed);
+					if (t < T(_samples[segment - 1].t) || t > T(_samples[segment].t)) {
+						// sequential times: the next segments are passed one by one and checked
+						size_t next = segment;
+						for (size_t walk = 0; walk < MAX_WALK && next + 1 < count && t > T(_samples[next].t); ++walk) {
+							_file->check_segment(_samples, ++next);
+						}
+						if (t >= T(_samples[next - 1].t) && t <= T(_samples[next].t)) {
+							segment = next;
+						} else {
+							const auto it = std::lower_bound(_samples + 1, _samples + count, t,
+								[](const ProgramSample& sample, T value) { return T(sample.t) < value; });
+							segment = static_cast<size_t>(it - _samples);
+							_file->check_segment(_samples, segment);
+							if (t < T(_samples[segment - 1].t) || t > T(_samples[segment].t)) {
+								// the binary search on decreasing times
+								throw error::WrongProgram(_file->path(), "times of the path are not increasing");
+							}
+						}
+						_hint.store(segment, std::memory_order_relaxed);
+					}
+					const T t_l = T(_samples[segment - 1].t);
+					return (t - t_l) / (T(_samples[segment].t) - t_l);
+				}
+
+				void interpolate(size_t segment, T w, tens::M3x3<T>& X) const {
+					const double* l = _samples[segment - 1].comp;
+					const double* r = _samples[segment].comp;
+					for (size_t c = 0; c < 9; ++c) {
+						X[c] = T(l[c]) + w * (T(r[c]) - T(l[c]));
+					}
+				}
+			public:
+				Program(const std::shared_ptr<const ProgramFile>& file, size_t path) :
+					_file(file), _samples(nullptr)
+				{
+					if (path >= file->path_count()) {
+						throw std::out_of_range("Loading program " + file->path() + ": no path " + std::to_string(path));
+					}
+					_samples = file->samples(path);
+					file->check_segment(_samples, 1);
+				};
+
+				virtual void rate(T t, tens::M3x3<T>& L) const override {
+					size_t segment;
+					const T w = locate(t, segment);
+					if (_file->kind() == program_kind::RATE) {
+						interpolate(segment, w, L);
+						return;
+					}
+					// dF/dt.F^-1
+					tens::M3x3<T> F_inv(tens::FILL_TYPE::ZERO);
+					interpolate(segment, w, F_inv);
+					inverse(F_inv);
+					const double* l = _samples[segment - 1].comp;
+					const double* r = _samples[segment].comp;
+					const T dt = T(_samples[segment].t - _samples[segment - 1].t);
+					for (size_t c = 0; c < 9; ++c) {
+						L[c] = (T(r[c]) - T(l[c])) / dt;
+					}
+					L *= F_inv;
+				}
+
+				virtual void value(T t, tens::M3x3<T>& F) const override {
+					if (_file->kind() != program_kind::VALUE) {
+						throw error::WrongProgram(_file->path(), "program of L does not define F, use RATE_CALCULATE schema");
+					}
+					size_t segment;
+					const T w = locate(t, segment);
+					interpolate(segment, w, F);
+				}
+			};
+
+			// paths of the program for points: the only path of the program is imposed on all points, else the path i on the point i
+			template<class Points>
+			void assign_program(const Points& points, const std::shared_ptr<const ProgramFile>& file) {
+				if (file->path_count() != 1 && file->path_count() != points.size()) {
+					throw error::WrongProgram(file->path(), std::to_string(file->path_count()) + " paths for " + std::to_string(points.size()) + " points");
+				}
+				for (size_t i = 0; i < points.size(); ++i) {
+					using T = std::remove_cvref_t<decltype(points[i]->t())>;
+					points[i]->strain()->set_path(std::make_shared<const Program<T>>(file, file->path_count() == 1 ? 0 : i));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace io {
+	namespace error {
+		class MapFailed : public std::exception {
+			std::string _msg;
+		public:
+			MapFailed(const std::string& path, const std::string& reason) :
+				_msg("Failed to map file: " + path + " \n Reason: " + reason) {};
+			virtual const char* what() const noexcept {
+				return _msg.c_str();
+			};
+		};
+	}
+
+	/*
+		Memory-mapped file: read-only mapping of existing file
+		or read-write mapping of a file created with given size
+	*/
+	class MappedFile {
+		std::string _path;
+		char* _data = nullptr;
+		size_t _size = 0;
+#ifdef _WIN32
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = nullptr;
+#else
+		int _fd = -1;
+#endif
+
+		void _map(bool writable) {
+#ifdef _WIN32
+			_mapping = CreateFileMappingA(_file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+			if (_mapping == nullptr) {
+				throw error::MapFailed(_path, "CreateFileMapping");
+			}
+			_data = static_cast<char*>(MapViewOfFile(_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, _size));
+			if (_data == nullptr) {
+				throw error::MapFailed(_path, "MapViewOfFile");
+			}
+#else
+			void* ptr = mmap(nullptr, _size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, _fd, 0);
+			if (ptr == MAP_FAILED) {
+				throw error::MapFailed(_path, "mmap");
+			}
+			_data = static_cast<char*>(ptr);
+#endif
+		}
+
+		void _release() {
+#ifdef _WIN32
+			if (_data) UnmapViewOfFile(_data);
+			if (_mapping) CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+			_mapping = nullptr;
+			_file = INVALID_HANDLE_VALUE;
+#else
+			if (_data) munmap(_data, _size);
+			if (_fd >= 0) close(_fd);
+			_fd = -1;
+#endif
+			_data = nullptr;
+			_size = 0;
+		}
+
+		MappedFile() = default;
+
+	public:
+		// mapping of the whole existing file
+		explicit MappedFile(const std::string& path, bool writable = false) : _path(path) {
+			try {
+#ifdef _WIN32
+				_file = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (_file == INVALID_HANDLE_VALUE) {
+					throw error::MapFailed(_path, "failed to open file");
+				}
+				LARGE_INTEGER size;
+				GetFileSizeEx(_file, &size);
+				_size = static_cast<size_t>(size.QuadPart);
+#else
+				_fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+				if (_fd < 0) {
+					throw error::MapFailed(_path, "failed to open file");
+				}
+				struct stat st;
+				if (fstat(_fd, &st) != 0) {
+					throw error::MapFailed(_path, "fstat");
+				}
+				_size = static_cast<size_t>(st.st_size);
+#endif
+				if (_size == 0) {
+					throw error::MapFailed(_path, "file is empty");
+				}
+				_map(writable);
+			} catch (...) {
+				_release();
+				throw;
+			}
+		}
+
+		// read-write mapping of a file, the file is created (or truncated) with given size
+		static MappedFile create(const std::string& path, size_t size) {
+			MappedFile file;
+			file._path = path;
+			file._size = size;
+			try {
+#ifdef _WIN32
+				file._file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file._file == INVALID_HANDLE_VALUE) {
+					throw error::MapFailed(path, "failed to create file");
+				}
+				LARGE_INTEGER li;
+				li.QuadPart = static_cast<LONGLONG>(size);
+				if (!SetFilePointerEx(file._file, li, nullptr, FILE_BEGIN) || !SetEndOfFile(file._file)) {
+					throw error::MapFailed(path, "failed to resize file");
+				}
+#else
+				file._fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+				if (file._fd < 0) {
+					throw error::MapFailed(path, "failed to create file");
+				}
+				if (ftruncate(file._fd, static_cast<off_t>(size)) != 0) {
+					throw error::MapFailed(path, "failed to resize file");
+				}
+#endif
+				file._map(true);
+			} catch (...) {
+				file._release();
+				throw;
+			}
+			return file;
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator= (const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& src) noexcept {
+			*this = std::move(src);
+		}
+
+		MappedFile& operator= (MappedFile&& src) noexcept {
+			if (this != &src) {
+				_release();
+				_path = std::move(src._path);
+				std::swap(_data, src._data);
+				std::swap(_size, src._size);
+#ifdef _WIN32
+				std::swap(_file, src._file);
+				std::swap(_mapping, src._mapping);
+#else
+				std::swap(_fd, src._fd);
+#endif
+			}
+			return *this;
+		}
+
+		~MappedFile() {
+			_release();
+		}
+
+		const char* data() const { return _data; };
+		char* data() { return _data; };
+		size_t size() const { return _size; };
+		const std::string& path() const { return _path; };
+
+		// schedules (async = true) or waits for writing dirty pages of [offset, offset + size) to the file
+		void flush(size_t offset, size_t size, bool async = true) {
+#ifdef _WIN32
+			FlushViewOfFile(_data + offset, size);
+			if (!async) FlushFileBuffers(_file);
+#else
+			const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			const size_t begin = offset / page * page;
+			msync(_data + begin, size + offset - begin, async ? MS_ASYNC : MS_SYNC);
+#endif
+		}
+
+		void flush(bool async = true) {
+			flush(0, _size, async);
+		}
+	};
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "single_include/nlohmann/json.hpp"
+#include "../tensor-matrix/tensor/profile.h"
+#include "../tensor-matrix/tensor/trace.h"
 using json = nlohmann::json;
 
 namespace state {
@@ -25,14 +27,75 @@ namespace measure {
 	};
 	extern type_schema DEFAULT_NUMERICAL_SCHEMA;
 
+	// type-erased access to numeric buffers of a measure (checkpoints, output, point-wise integrators)
+	template<typename T>
+	class BaseMeasure {
+	public:
+		virtual ~BaseMeasure() = default;
+		virtual const std::string& name() const = 0;
+		// number of components of value (rate)
+		virtual size_t comp_size() const = 0;
+		// number of T in the packed state (see write_state)
+		virtual size_t state_size() const = 0;
+		// packs all buffers into dst[0, state_size())
+		virtual void write_state(T* dst) const = 0;
+		// unpacks all buffers from src[0, state_size())
+		virtual void read_state(const T* src) = 0;
+		virtual const T* value_data() const = 0;
+		virtual const T* rate_data() const = 0;
+		// number of previous values (rates) kept by the measure
+		virtual size_t history_depth() const = 0;
+		// previous values (rates): k = 0 is the current one, k = -1 the previous one, ..., k = -history_depth()
+		virtual const T* value_data_at(int k) const = 0;
+		virtual const T* rate_data_at(int k) const = 0;
+		// time derivative of the value at the current rate (dst = dX/dt for X = value)
+		virtual void value_derivative(const T* value, T* dst) const = 0;
+		// overwrites value (e.g. by a stage value of a point-wise integrator)
+		virtual void assign_value(const T* value) = 0;
+		// accepts value and rate of the step through value_temp/rate_temp (as update_value/update_rate)
+		virtual void commit(const T* value, const T* rate) = 0;
+		// internal variables integrated together with the value (e.g. resistances of a relation), none by default
+		virtual size_t internal_size() const { return 0; };
+		// k = 0 current internal variables, k = -1 previous ones
+		virtual void internal_at(int k, T* dst) const {};
+		// time derivatives of internal variables evaluated by the last equation
+		virtual void internal_derivative(T* dst) const {};
+		// overwrites internal variables (a stage of an integrator)
+		virtual void assign_internal(const T* src) {};
+		// accepts internal variables and their derivatives of the step, the current ones become previous
+		virtual void commit_internal(const T* src, const T* derivative) {};
+		virtual T time() const = 0;
+		virtual void set_time(T t) = 0;
+		virtual T rate_intensity() const = 0;
+		virtual T value_intensity() const = 0;
+	};
+
+	/*
+		previous values and rates are kept in ring buffers of history_depth() containers (1 by default):
+		a step overwrites the oldest slot and moves the head, so older values are not moved
+	*/
 	template<template<class, std::size_t, std::size_t> class Q, class T, size_t DIM, size_t RANK>
-	class AbstractMeasure {
+	class AbstractMeasure : public BaseMeasure<T> {
 		std::string _name;
 		Q<T, DIM, RANK>& _value;
 		Q<T, DIM, RANK> _rate;
-		Q<T, DIM, RANK> _value_prev;
-		Q<T, DIM, RANK> _rate_prev;
+		std::vector<Q<T, DIM, RANK>> _values; // previous values, value_at(-1) at _value_head
+		std::vector<Q<T, DIM, RANK>> _rates;  // previous rates, rate_at(-1) at _rate_head
+		size_t _value_head = 0;
+		size_t _rate_head = 0;
 		int _lock = 0; // to prevent updates during calc step
+
+		// slot of the k-th previous container of the ring with the head
+		size_t slot(size_t head, int k) const {
+			if (k >= 0 || size_t(-k) > history_depth()) {
+				throw std::out_of_range("Measure " + _name + ": history has no step " + std::to_string(k));
+			}
+			return (head + history_depth() - size_t(-k - 1)) % history_depth();
+		}
+
+		static void advance(size_t& head, size_t depth) {
+			if (++head == depth) head = 0;
+		}
 	protected:
 		// use reference rate_temp / value_temp for temporary calculation to prevent a new allocation
 		// update_rate()/update_value() use rate_temp / value_temp value as a new one (for more info see declaration)
@@ -44,17 +107,93 @@ namespace measure {
 			_name(name),
 			_value(value),
 			_rate(std::move(rate)),
-			_value_prev(_value),
-			_rate_prev(_rate),
+			_values(1, _value),
+			_rates(1, _rate),
 			value_temp(_value),
 			rate_temp(_rate) {};
 
 		// const refs to private fields
 		const Q<T, DIM, RANK>& rate() const { return _rate; };
 		const Q<T, DIM, RANK>& value() const { return _value; };
-		const Q<T, DIM, RANK>& rate_prev() const { return _rate_prev; };
-		const Q<T, DIM, RANK>& value_prev() const { return _value_prev; };
-		const std::string& name() const { return _name; };
+		const Q<T, DIM, RANK>& rate_prev() const { return _rates[_rate_head]; };
+		const Q<T, DIM, RANK>& value_prev() const { return _values[_value_head]; };
+		virtual const std::string& name() const override { return _name; };
+
+		// ---------------------------------- history ----------------------------------------
+		virtual size_t history_depth() const override { return _values.size(); };
+
+		// k = 0 is the current value, k = -1 the previous one, ..., k = -history_depth()
+		const Q<T, DIM, RANK>& value_at(int k) const { return k == 0 ? _value : _values[slot(_value_head, k)]; };
+		const Q<T, DIM, RANK>& rate_at(int k) const { return k == 0 ? _rate : _rates[slot(_rate_head, k)]; };
+		virtual const T* value_data_at(int k) const override { return value_at(k).data(); };
+		virtual const T* rate_data_at(int k) const override { return rate_at(k).data(); };
+
+		// new depth of the history filled by the current value and rate (allocates, set it before steps)
+		void set_history_depth(size_t depth) {
+			if (depth == 0) {
+				throw std::invalid_argument("Measure " + _name + ": history depth must be positive");
+			}
+			_values.assign(depth, _value);
+			_rates.assign(depth, _rate);
+			_value_head = _rate_head = 0;
+		};
+
+		// ---------------------------------- packed state ----------------------------------------
+		// layout: value | rate | value_at(-1) ... value_at(-depth) | rate_at(-1) ... rate_at(-depth) | value_temp | rate_temp
+		size_t buffers_count() const { return 4 + 2 * history_depth(); };
+
+		virtual size_t comp_size() const override { return _rate.size(); };
+		virtual size_t state_size() const override { return buffers_count() * comp_size(); };
+		virtual const T* value_data() const override { return _value.data(); };
+		virtual const T* rate_data() const override { return _rate.data(); };
+
+		virtual void write_state(T* dst) const override {
+			const size_t size = comp_size();
+			const auto write = [&](const Q<T, DIM, RANK>& buffer) {
+				memcpy(dst, buffer.data(), size * sizeof(T));
+				dst += size;
+			};
+			write(_value);
+			write(_rate);
+			for (size_t k = 1; k <= history_depth(); ++k) write(value_at(-int(k)));
+			for (size_t k = 1; k <= history_depth(); ++k) write(rate_at(-int(k)));
+			write(value_temp);
+			write(rate_temp);
+		};
+
+		// value is integrated additively by default (see integrate_value), so dX/dt = rate
+		virtual void value_derivative(const T* value, T* dst) const override {
+			memcpy(dst, _rate.data(), comp_size() * sizeof(T));
+		};
+
+		virtual void assign_value(const T* value) override {
+			memcpy(_value.data(), value, comp_size() * sizeof(T));
+		};
+
+		virtual void commit(const T* value, const T* rate) override {
+			memcpy(value_temp.data(), value, comp_size() * sizeof(T));
+			update_value();
+			memcpy(rate_temp.data(), rate, comp_size() * sizeof(T));
+			update_rate();
+		};
+
+		virtual T time() const override { return T(0); };
+		virtual void set_time(T t) override {};
+
+		virtual void read_state(const T* src) override {
+			const size_t size = comp_size();
+			const auto read = [&](Q<T, DIM, RANK>& buffer) {
+				memcpy(buffer.data(), src, size * sizeof(T));
+				src += size;
+			};
+			_value_head = _rate_head = 0;
+			read(_value);
+			read(_rate);
+			for (size_t k = 1; k <= history_depth(); ++k) read(_values[slot(0, -int(k))]);
+			for (size_t k = 1; k <= history_depth(); ++k) read(_rates[slot(0, -int(k))]);
+			read(value_temp);
+			read(rate_temp);
+		};
 
 		// to prevent modifying rate and value you should lock measure
 		int lock() {
@@ -71,28 +210,28 @@ namespace measure {
 		void update_value(const Q<T, DIM, RANK>& value) {
 			value_temp = value;
 		};
-		// method uses value_temp as a new one (swap pointers, more efficient)
+		// method uses value_temp as a new one, the current value takes the oldest slot of the history
+		// (_value is linked to components of the measure, so it is copied, the history is not moved)
 		void update_value() {
 #ifdef _DEBUG
-			if (_lock) throw new std::logic_error("updates are locked");
+			if (_lock) throw std::logic_error("updates are locked");
 #endif
-			// _value = _value_temp, _value_temp = _value
-			std::swap(_value, value_temp);
-			// _value_temp = _value_prev, _value_prev = _value_temp
-			std::swap(_value_prev, value_temp);
-			// _value = _value_temp, _value_prev = _value, _value_temp = _value_prev
+			advance(_value_head, history_depth());
+			_values[_value_head] = _value;
+			_value = value_temp;
 		};
 
 		void update_rate(const Q<T, DIM, RANK>& rate) {
 			rate_temp = rate;
 		};
-		// method uses rate_temp as a new one (swap pointers, more efficient)
+		// method uses rate_temp as a new one, the current rate takes the oldest slot of the history
 		void update_rate() {
 #ifdef _DEBUG
-			if (_lock) throw new std::logic_error("updates are locked");
+			if (_lock) throw std::logic_error("updates are locked");
 #endif
-			std::swap(_rate, rate_temp);
-			std::swap(_rate_prev, rate_temp);
+			advance(_rate_head, history_depth());
+			_rates[_rate_head] = _rate;
+			_rate = rate_temp;
 		};
 
 		// ============================================================================= //
@@ -121,7 +260,7 @@ namespace measure {
 		// update_rate() uses this->rate_temp value as a new one (for more info see declaration)
 		virtual void calc_rate(T dt) {
 			rate_temp = _value;
-			rate_temp -= _value_prev;
+			rate_temp -= value_prev();
 			rate_temp /= dt;
 		};
 
@@ -204,6 +343,12 @@ namespace measure {
 	template<class T, size_t DIM, size_t RANK, template<class> class Schema = AbstractSchema_>
 	class StateMeasureSchema : public StateMeasure<T, DIM, RANK>, public Schema<T> {
 		StateMeasure<T, DIM, RANK>& measure;
+#ifdef TENS_PROFILE
+		const size_t _profile_slot = profile::slot(this->name());
+#endif
+#ifdef TENS_TRACE
+		const uint32_t _trace_name = trace::intern(this->name());
+#endif
 	protected:
 		const measure::type_schema _type;
 	public:
@@ -218,25 +363,38 @@ namespace measure {
 		virtual void init() {};
 
 		virtual void calc(T dt) {
+			TENS_TRACE_SCOPE(_trace_name, measure);
 #ifdef _DEBUG
 			//_key = measure.lock();
 #endif
 			switch (_type)
 			{
 			case measure::type_schema::RATE_CALCULATE:
-				measure.rate_equation(AbstractSchema_<T>::_t, dt);
+				{
+					TENS_PROFILE_MEASURE_SCOPE(RATE_EQUATION, _profile_slot);
+					measure.rate_equation(AbstractSchema_<T>::_t, dt);
+				}
 				measure.update_rate();
-				measure.integrate_value(dt);
+				{
+					TENS_PROFILE_MEASURE_SCOPE(INTEGRATE_VALUE, _profile_slot);
+					measure.integrate_value(dt);
+				}
 				measure.update_value();
 				break;
 			case measure::type_schema::FINITE_CALCULATE:
-				measure.finite_equation(AbstractSchema_<T>::_t, dt);
+				{
+					TENS_PROFILE_MEASURE_SCOPE(FINITE_EQUATION, _profile_slot);
+					measure.finite_equation(AbstractSchema_<T>::_t, dt);
+				}
 				measure.update_value();
-				measure.calc_rate(dt);
+				{
+					TENS_PROFILE_MEASURE_SCOPE(CALC_RATE, _profile_slot);
+					measure.calc_rate(dt);
+				}
 				measure.update_rate();
 				break;
 			default:
-				//throw new error::UndefinedNumericalSchema();
+				//throw error::UndefinedNumericalSchema();
 				break;
 			}
 			AbstractSchema_<T>::inc_time(dt);
@@ -248,6 +406,29 @@ namespace measure {
 #endif
 		};
 
+		virtual T time() const override {
+			return AbstractSchema_<T>::_t;
+		};
+
+		virtual void set_time(T t) override {
+			AbstractSchema_<T>::_t = t;
+		};
+
+		// packed state of the measure and the time of the schema
+		virtual size_t state_size() const override {
+			return StateMeasure<T, DIM, RANK>::state_size() + 1;
+		};
+
+		virtual void write_state(T* dst) const override {
+			StateMeasure<T, DIM, RANK>::write_state(dst);
+			dst[StateMeasure<T, DIM, RANK>::state_size()] = AbstractSchema_<T>::_t;
+		};
+
+		virtual void read_state(const T* src) override {
+			StateMeasure<T, DIM, RANK>::read_state(src);
+			AbstractSchema_<T>::_t = src[StateMeasure<T, DIM, RANK>::state_size()];
+		};
+
 		void set_numerical_schema(measure::type_schema type) {
 			_type = type;
 		}
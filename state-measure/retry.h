@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <vector>
+#include "../state-measure/state.h"
+
+namespace numerical_schema {
+	using namespace state;
+
+	struct RetryParams {
+		size_t max_depth = 4; // the last retry is 2^max_depth substeps
+	};
+
+	// aggregated over points and steps
+	struct FailureStatistics {
+		size_t steps = 0;       // point steps
+		size_t failed = 0;      // point steps failed at the first attempt
+		size_t recovered = 0;   // failed ones completed by substeps
+		size_t unrecovered = 0; // failed ones restored to the state at the beginning of the step
+		size_t substeps = 0;    // all substeps of retries
+		std::array<size_t, STEP_STATUS_COUNT> first_status{ 0 }; // status of the first attempt
+		std::array<size_t, STEP_STATUS_COUNT> final_status{ 0 }; // status of unrecovered steps
+
+		FailureStatistics& operator+= (const FailureStatistics& other) {
+			steps += other.steps;
+			failed += other.failed;
+			recovered += other.recovered;
+			unrecovered += other.unrecovered;
+			substeps += other.substeps;
+			for (size_t i = 0; i < STEP_STATUS_COUNT; ++i) {
+				first_status[i] += other.first_status[i];
+				final_status[i] += other.final_status[i];
+			}
+			return *this;
+		}
+	};
+
+	/*
+		Non-throwing step of points with automatic substep retry:
+			- the state of a point is saved before the step (packed state, the buffer is allocated once)
+			- a failed step is retried from the saved state by 2, 4, ... 2^max_depth substeps
+			- if all retries fail, the point is restored to the beginning of the step and the status of the last retry is returned
+		one bad point does not stop a batch, statuses are per point
+	*/
+	template<typename T>
+	class SubstepRetry {
+		RetryParams _params;
+		FailureStatistics _stat;
+		std::vector<T> _start;
+
+		step_status substeps(MaterialPoint<T, 3>& point, T dt, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				_stat.substeps++;
+				const auto status = point.try_step(dt / T(count));
+				if (status != step_status::OK) return status;
+			}
+			return step_status::OK;
+		}
+
+	public:
+		SubstepRetry(const RetryParams& params = RetryParams()) : _params(params) {};
+
+		const FailureStatistics& statistics() const { return _stat; };
+		void reset_statistics() { _stat = FailureStatistics(); };
+
+		step_status step(MaterialPoint<T, 3>& point, T dt) {
+			_start.resize(point.state_size());
+			point.save_state(_start.data());
+			_stat.steps++;
+			auto status = point.try_step(dt);
+			if (status == step_status::OK) {
+				return status;
+			}
+			_stat.failed++;
+			_stat.first_status[static_cast<size_t>(status)]++;
+			for (size_t depth = 1; depth <= _params.max_depth; ++depth) {
+				point.load_state(_start.data());
+				status = substeps(point, dt, size_t(1) << depth);
+				if (status == step_status::OK) {
+					_stat.recovered++;
+					return status;
+				}
+			}
+			point.load_state(_start.data());
+			_stat.unrecovered++;
+			_stat.final_status[static_cast<size_t>(status)]++;
+			return status;
+		}
+
+		// step of the batch, status[i] is the status of the point i, returns number of unrecovered points
+		template<class Point>
+		size_t step(const std::vector<std::shared_ptr<Point>>& points, T dt, std::vector<step_status>& status) {
+			status.resize(points.size());
+			size_t failed = 0;
+			for (size_t idx = 0; idx < points.size(); ++idx) {
+				status[idx] = step(*points[idx], dt);
+				failed += status[idx] != step_status::OK;
+			}
+			return failed;
+		}
+	};
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "../tensor-matrix/tensor/object.h"
 #include "../state-measure/measure.h"
+#include "../tensor-matrix/tensor/trace.h"
 
 namespace numerical_schema {
 	namespace error {
@@ -48,6 +49,22 @@ namespace numerical_schema {
 	}
 
 
+	// result of the non-throwing step (see AbstractSchema::try_step)
+	enum class step_status : uint8_t {
+		OK,
+		DIVISION_BY_ZERO, // e.g. inversion of a singular matrix
+		NON_ORTHOGONAL,
+		OUT_OF_RANGE,     // e.g. value is out of a curve
+		NOT_FINITE,       // nan or inf in the state
+		FAILED            // any other error
+	};
+	constexpr size_t STEP_STATUS_COUNT = 6;
+
+	inline const char* to_string(step_status status) {
+		const char* names[STEP_STATUS_COUNT] = { "ok", "division by zero", "non orthogonal", "out of range", "not finite", "failed" };
+		return names[static_cast<size_t>(status)];
+	}
+
 	template <typename T>
 	class AbstractSchema {
 	protected:
@@ -59,16 +76,58 @@ namespace numerical_schema {
 		void inc_time(T dt) {
 			_t += dt;
 		}
-		T t() { return _t; };
-		virtual void step(T dt) {
-			try {
+		T t() const { return _t; };
+
+		// init, calc, finalize (phases are separate events of the trace)
+		void step_phases(T dt) {
+			{
+				TENS_TRACE_SCOPE(trace::INIT, schema);
 				init();
+			}
+			{
+				TENS_TRACE_SCOPE(trace::CALC, schema);
 				calc(dt);
+			}
+			{
+				TENS_TRACE_SCOPE(trace::FINALIZE, schema);
 				finalize();
+			}
+		}
+
+		virtual void step(T dt) {
+			TENS_TRACE_SCOPE(trace::STEP, schema);
+			try {
+				step_phases(dt);
+				inc_time(dt);
 			} catch (const std::exception &e){
 				std::cout << "Error during calculation. Reason: " << e.what();
 				exit(1);
 			}
 		};
+
+		// runs phases of a step without exceptions, an error is returned as a status (a batch may run phases of points separately)
+		template<class Phases>
+		static step_status try_phases(const Phases& phases) noexcept {
+			try {
+				phases();
+			} catch (const ErrorMath::DivisionByZero&) {
+				return step_status::DIVISION_BY_ZERO;
+			} catch (const ErrorMath::NonOrthogonal&) {
+				return step_status::NON_ORTHOGONAL;
+			} catch (const std::out_of_range&) {
+				return step_status::OUT_OF_RANGE;
+			} catch (...) {
+				return step_status::FAILED;
+			}
+			return step_status::OK;
+		}
+
+		// step without exceptions and exit, an error is returned as a status (the state may be partially updated)
+		virtual step_status try_step(T dt) noexcept {
+			TENS_TRACE_SCOPE(trace::STEP, schema);
+			const auto status = try_phases([&] { step_phases(dt); });
+			if (status == step_status::OK) inc_time(dt);
+			return status;
+		};
 	};
 };
@@ -0,0 +1,151 @@
+#pragma once
+#include <string>
+#include <utility>
+#include "./mapped_file.h"
+
+namespace io {
+	/*
+		Named shared memory segment (POSIX shm_open / named file mapping on Windows)
+		the creator owns the name: it is removed when the created segment is destroyed,
+		processes opened the segment keep their mappings until destroying own objects
+	*/
+	class SharedMemory {
+		std::string _name;
+		char* _data = nullptr;
+		size_t _size = 0;
+		bool _owner = false;
+#ifdef _WIN32
+		HANDLE _mapping = nullptr;
+#endif
+
+		void _release() {
+#ifdef _WIN32
+			if (_data) UnmapViewOfFile(_data);
+			if (_mapping) CloseHandle(_mapping);
+			_mapping = nullptr;
+#else
+			if (_data) munmap(_data, _size);
+			if (_owner) shm_unlink(_name.c_str());
+#endif
+			_data = nullptr;
+			_size = 0;
+			_owner = false;
+		}
+
+		SharedMemory() = default;
+
+	public:
+		// new zero-filled segment of given size, fails if the name exists
+		static SharedMemory create(const std::string& name, size_t size) {
+			SharedMemory memory;
+			memory._name = name;
+			memory._size = size;
+			try {
+#ifdef _WIN32
+				memory._mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+					static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32), static_cast<DWORD>(size & 0xFFFFFFFFull), name.c_str());
+				if (memory._mapping == nullptr || GetLastError() == ERROR_ALREADY_EXISTS) {
+					throw error::MapFailed(name, "failed to create shared memory");
+				}
+				memory._data = static_cast<char*>(MapViewOfFile(memory._mapping, FILE_MAP_WRITE, 0, 0, size));
+				if (memory._data == nullptr) {
+					throw error::MapFailed(name, "MapViewOfFile");
+				}
+#else
+				const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+				if (fd < 0) {
+					throw error::MapFailed(name, "failed to create shared memory");
+				}
+				memory._owner = true;
+				if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+					close(fd);
+					throw error::MapFailed(name, "failed to resize shared memory");
+				}
+				void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				close(fd);
+				if (ptr == MAP_FAILED) {
+					throw error::MapFailed(name, "mmap");
+				}
+				memory._data = static_cast<char*>(ptr);
+#endif
+			} catch (...) {
+				memory._release();
+				throw;
+			}
+			return memory;
+		}
+
+		// mapping of the whole existing segment
+		static SharedMemory open(const std::string& name, bool writable = false) {
+			SharedMemory memory;
+			memory._name = name;
+			try {
+#ifdef _WIN32
+				memory._mapping = OpenFileMappingA(writable ? FILE_MAP_WRITE : FILE_MAP_READ, FALSE, name.c_str());
+				if (memory._mapping == nullptr) {
+					throw error::MapFailed(name, "failed to open shared memory");
+				}
+				memory._data = static_cast<char*>(MapViewOfFile(memory._mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+				if (memory._data == nullptr) {
+					throw error::MapFailed(name, "MapViewOfFile");
+				}
+				MEMORY_BASIC_INFORMATION info;
+				VirtualQuery(memory._data, &info, sizeof(info));
+				memory._size = static_cast<size_t>(info.RegionSize);
+#else
+				const int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+				if (fd < 0) {
+					throw error::MapFailed(name, "failed to open shared memory");
+				}
+				struct stat st;
+				if (fstat(fd, &st) != 0) {
+					close(fd);
+					throw error::MapFailed(name, "fstat");
+				}
+				memory._size = static_cast<size_t>(st.st_size);
+				void* ptr = memory._size ? mmap(nullptr, memory._size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+				close(fd);
+				if (ptr == MAP_FAILED) {
+					throw error::MapFailed(name, "mmap");
+				}
+				memory._data = static_cast<char*>(ptr);
+#endif
+			} catch (...) {
+				memory._release();
+				throw;
+			}
+			return memory;
+		}
+
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator= (const SharedMemory&) = delete;
+
+		SharedMemory(SharedMemory&& src) noexcept {
+			*this = std::move(src);
+		}
+
+		SharedMemory& operator= (SharedMemory&& src) noexcept {
+			if (this != &src) {
+				_release();
+				_name = std::move(src._name);
+				std::swap(_data, src._data);
+				std::swap(_size, src._size);
+				std::swap(_owner, src._owner);
+#ifdef _WIN32
+				std::swap(_mapping, src._mapping);
+#endif
+			}
+			return *this;
+		}
+
+		~SharedMemory() {
+			_release();
+		}
+
+		const char* data() const { return _data; };
+		char* data() { return _data; };
+		// on Windows the size of an opened segment is rounded up to pages
+		size_t size() const { return _size; };
+		const std::string& name() const { return _name; };
+	};
+};
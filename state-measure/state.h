@@ -6,6 +6,7 @@
 #include "../tensor-matrix/state-measure/stress.h"
 #include "../tensor-matrix/state-measure/scalar.h"
 #include <unordered_map>
+#include <vector>
 
 namespace state {
 	using namespace measure;
@@ -17,23 +18,93 @@ namespace state {
 	template<class T, size_t DIM>
 	class MaterialPoint : public AbstractSchema<T> {
 		Basis<T, DIM> _basis;
+		std::vector<std::shared_ptr<BaseMeasure<T>>> _measures; // in order of registration
 	protected:
-		std::shared_ptr<json> _params;
+		std::shared_ptr<const json> _params;
+		const measure::type_schema _type;
+
+		// measure becomes a part of the packed state of the point
+		void register_measure(const std::shared_ptr<BaseMeasure<T>>& measure) {
+			_measures.push_back(measure);
+		}
 	public:
 		virtual void init() override {};
 		virtual void calc(T dt) override {};
 		virtual void finalize()  override {};
 		MaterialPoint(const json& params, measure::type_schema type) :
-			_basis(tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM))
+			MaterialPoint(std::make_shared<const json>(params), tens::create_basis<T, 3>(tens::DEFAULT_ORTH_BASIS::RANDOM), type)
+		{
+		};
+		// params are shared (not copied) between points, basis is own orientation of the point
+		MaterialPoint(const std::shared_ptr<const json>& params, const Basis<T, DIM>& basis, measure::type_schema type) :
+			_basis(basis),
+			_params(params),
+			_type(type)
 		{
 		};
 		const Basis<T, DIM>& basis() {
 			return _basis;
 		}
 
+		measure::type_schema numerical_schema_type() const {
+			return _type;
+		}
+
 		const std::shared_ptr<const json>& param() const {
 			return _params;
 		}
+
+		const std::vector<std::shared_ptr<BaseMeasure<T>>>& measures() const {
+			return _measures;
+		}
+
+		// ---------------------------------- packed state ----------------------------------------
+		// layout: t | basis | state of measure 0 | state of measure 1 | ...
+		size_t state_size() const {
+			size_t size = 1 + _basis->size();
+			for (const auto& measure : _measures) {
+				size += measure->state_size();
+			}
+			return size;
+		}
+
+		void save_state(T* dst) const {
+			*dst++ = this->_t;
+			memcpy(dst, _basis->data(), _basis->size() * sizeof(T));
+			dst += _basis->size();
+			for (const auto& measure : _measures) {
+				measure->write_state(dst);
+				dst += measure->state_size();
+			}
+		}
+
+		void load_state(const T* src) {
+			this->_t = *src++;
+			memcpy(_basis->data(), src, _basis->size() * sizeof(T));
+			src += _basis->size();
+			for (const auto& measure : _measures) {
+				measure->read_state(src);
+				src += measure->state_size();
+			}
+		}
+
+		// true if values and rates of all measures are finite
+		bool is_finite() const {
+			for (const auto& measure : _measures) {
+				for (const T* data : { measure->value_data(), measure->rate_data() }) {
+					for (size_t i = 0; i < measure->comp_size(); ++i) {
+						if (!std::isfinite(data[i])) return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		virtual step_status try_step(T dt) noexcept override {
+			const auto status = AbstractSchema<T>::try_step(dt);
+			return status == step_status::OK && !is_finite() ? step_status::NOT_FINITE : status;
+		}
+
 		template<typename T, size_t DIM>
 		friend std::ostream& operator<< (std::ostream& o, const MaterialPoint<T, DIM>& b);
 
@@ -8,12 +8,64 @@ namespace measure {
 	namespace strain {
 		const std::string DEFORM_GRADIENT = "F";
 
+		namespace loading {
+			// imposed history of the deformation gradient, components at the basis of the point
+			template<typename T>
+			class Path {
+			public:
+				virtual ~Path() = default;
+				virtual void rate(T t, tens::M3x3<T>& L) const = 0;
+				virtual void value(T t, tens::M3x3<T>& F) const = 0;
+			};
+		}
+
+		/*
+			kinematics of the deformation gradient shared by GradDeform and the static measures (see static_model.h)
+			dF/dt = L.F is integrated by the implicit first order schema
+		*/
+		namespace kinematics {
+			// F_n+1 = (I - L * dt)^-1 * F_n
+			template<typename T>
+			void integrate_value(const tens::M3x3<T>& L, const tens::M3x3<T>& F, T dt, tens::M3x3<T>& dst) {
+				dst = L;
+				(dst *= -dt) += IDENT_MATRIX<T, 3>; // I - L*dt
+				inverse(dst);
+				dst *= F;
+			}
+
+			// L_n+1 = (I - F_n * F_n+1^-1) / dt
+			template<typename T>
+			void calc_rate(const tens::M3x3<T>& F_prev, const tens::M3x3<T>& F, T dt, tens::M3x3<T>& L) {
+				L = F_prev;
+				L *= F.inverse();
+				(L -= IDENT_MATRIX<T, 3>) /= (-dt);
+			}
+
+			// ln(F.Ft)/2
+			template<typename T>
+			tens::M3x3<T> right_hencky(const tens::M3x3<T>& F) {
+				return func(F * F.transpose(), std::log) *= T(0.5);
+			}
+
+			template<typename T>
+			T rate_intensity(const tens::M3x3<T>& L) {
+				return std::sqrt(2 * convolution_transp(L, L) / 3);
+			}
+
+			template<typename T>
+			T value_intensity(const tens::M3x3<T>& F) {
+				const auto E = right_hencky(F);
+				return std::sqrt(2 * convolution_transp(E, E) / 3);
+			}
+		}
+
 		// Deformation gradient tensor
 		// see https://en.wikipedia.org/wiki/Finite_strain_theory for more information
 		template<typename T>
 		class GradDeform : public StateMeasureSchema<T, 3, 2> {
 			const std::unique_ptr<tens::M3x3<T>> E;  //  (Ft*F-I)/2
 			const std::unique_ptr<tens::M3x3<T>> dE; //  dE/dt = Ft*(L+Lt)*F/2
+			std::shared_ptr<const loading::Path<T>> _path; // the default loading if empty
 		public:
 			GradDeform(MaterialPoint<T, 3>& state, measure::type_schema type_schema, const std::string& name = DEFORM_GRADIENT) :
 				StateMeasureSchema<T, 3, 2>(state, name, tens::FILL_TYPE::INDENT, type_schema),
@@ -22,17 +74,26 @@ namespace measure {
 
 			// calc a new value F
 			virtual void integrate_value(T dt) override {
-				auto& df = this->value_temp = this->rate();
-				(df *= -dt) += IDENT_MATRIX<T, 3>; // I - L*dt
-				inverse(df); // (I - L * dt)^-1 * F
-				df *= this->value();
+				kinematics::integrate_value(this->rate(), this->value(), dt, this->value_temp);
 			};
 
 			// calc a new rate L
 			virtual void calc_rate(T dt) override {
-				auto& L = this->rate_temp = this->value_prev(); // fn_1
-				L *= this->value().inverse(); // fn_1 * fn^-1
-				(L -= IDENT_MATRIX<T, 3>) /= (-dt); // (I - fn_1 * fn^-1)/ dt
+				kinematics::calc_rate(this->value_prev(), this->value(), dt, this->rate_temp);
+			};
+
+			// dF/dt = L.F
+			virtual void value_derivative(const T* value, T* dst) const override {
+				math::dim3::mat_scal_mat(this->rate().data(), value, dst);
+			};
+
+			// loading of the point by the path (e.g. rotated macroscopic loading of a grain)
+			void set_path(const std::shared_ptr<const loading::Path<T>>& path) {
+				_path = path;
+			};
+
+			const std::shared_ptr<const loading::Path<T>>& path() const {
+				return _path;
 			};
 
 			// assignment a new rate L
@@ -43,13 +104,11 @@ namespace measure {
 
 			// ---------------------------------- helper const methods ----------------------------------------
 			virtual T rate_intensity() const override {
-				const auto& L = this->rate();
-				return std::sqrt(2*convolution_transp(L, L)/3);
+				return kinematics::rate_intensity(this->rate());
 			}
 
 			virtual T value_intensity() const override {
-				const auto E = right_hencky();
-				return std::sqrt(2 * convolution_transp(E, E) / 3);
+				return kinematics::value_intensity(this->value());
 			}
 
 			std::pair<tens::M3x3<T>, tens::M3x3<T>> polar_decomposition() const {
@@ -76,7 +135,7 @@ namespace measure {
 			}
 			// The right Hencky deformation tensor, ln(Ft.F)/2 = ln(V)
 			tens::M3x3<T> right_hencky() const {
-				return func(right_cauchy_green(), std::log)*= T(0.5); // ln(F.Ft)/2
+				return kinematics::right_hencky(this->value()); // ln(F.Ft)/2
 			}
 
 			// The left CauchyGreen deformation tensor, F.Ft
@@ -0,0 +1,42 @@
+#include <cstdlib>
+#include <new>
+#include "alloc_counter.h"
+
+namespace bench {
+	namespace alloc {
+		std::atomic<size_t> allocations{ 0 };
+		std::atomic<size_t> deallocations{ 0 };
+		std::atomic<size_t> bytes{ 0 };
+	}
+}
+
+namespace {
+	void* counted_alloc(std::size_t size) {
+		bench::alloc::allocations.fetch_add(1, std::memory_order_relaxed);
+		bench::alloc::bytes.fetch_add(size, std::memory_order_relaxed);
+		if (void* ptr = std::malloc(size ? size : 1)) {
+			return ptr;
+		}
+		throw std::bad_alloc();
+	}
+
+	void counted_free(void* ptr) noexcept {
+		if (ptr) {
+			bench::alloc::deallocations.fetch_add(1, std::memory_order_relaxed);
+			std::free(ptr);
+		}
+	}
+}
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { counted_free(ptr); }
@@ -0,0 +1,19 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace bench {
+	/*
+		Counter of heap allocations of the process, global operator new/delete are replaced in alloc_counter.cpp
+		(link it only into benchmark executables)
+	*/
+	namespace alloc {
+		extern std::atomic<size_t> allocations;
+		extern std::atomic<size_t> deallocations;
+		extern std::atomic<size_t> bytes;
+
+		inline size_t count() {
+			return allocations.load(std::memory_order_relaxed);
+		}
+	}
+}
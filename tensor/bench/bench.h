@@ -0,0 +1,154 @@
+#pragma once
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#include "alloc_counter.h"
+
+namespace bench {
+	// keeps the value (and computations of it) from being optimized out
+	template<class T>
+	inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#endif
+	}
+
+	// peak resident set size of the process (high-water mark since start), KB
+	inline size_t peak_rss_kb() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize / 1024 : 0;
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss) / 1024; // bytes
+#else
+		return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+	}
+
+	struct Result {
+		std::string group;
+		std::string name;
+		std::string impl;      // "tensor" or "eigen"
+		size_t iterations = 0;
+		double ns_per_op = 0;
+		double allocs_per_op = 0;
+	};
+
+	struct Options {
+		double min_time = 0.05; // seconds per case
+		std::string filter;     // substring of "group/name"
+		std::string format = "table"; // table, csv, json
+		std::string out;        // file, stdout if empty
+
+		static Options parse(int argc, char** argv) {
+			Options options;
+			for (int i = 1; i < argc; ++i) {
+				const std::string arg = argv[i];
+				const auto value = [&](const std::string& key) { return arg.rfind(key, 0) == 0 ? arg.substr(key.size()) : std::string(); };
+				if (!value("--min-time=").empty()) options.min_time = std::stod(value("--min-time="));
+				else if (!value("--filter=").empty()) options.filter = value("--filter=");
+				else if (!value("--format=").empty()) options.format = value("--format=");
+				else if (!value("--out=").empty()) options.out = value("--out=");
+			}
+			return options;
+		}
+	};
+
+	/*
+		Runs op (one operation per call) with growing number of iterations until the run takes min_time,
+		ns/op and heap allocations/op are given by the last run
+	*/
+	class Suite {
+		Options _options;
+		std::vector<Result> _results;
+
+	public:
+		Suite(const Options& options) : _options(options) {};
+
+		const std::vector<Result>& results() const { return _results; };
+
+		template<class Op>
+		void run(const std::string& group, const std::string& name, const std::string& impl, Op&& op) {
+			if (!_options.filter.empty() && (group + "/" + name).find(_options.filter) == std::string::npos) {
+				return;
+			}
+			for (size_t i = 0; i < 16; ++i) op(); // warm up
+			size_t iterations = 1;
+			while (true) {
+				const size_t allocs = alloc::count();
+				const auto start = std::chrono::steady_clock::now();
+				for (size_t i = 0; i < iterations; ++i) {
+					op();
+				}
+				const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				const size_t allocated = alloc::count() - allocs;
+				if (elapsed >= _options.min_time || iterations >= (size_t(1) << 34)) {
+					_results.push_back({ group, name, impl, iterations, elapsed * 1e9 / iterations, double(allocated) / iterations });
+					return;
+				}
+				iterations *= elapsed > 0 ? std::max<size_t>(2, std::min<size_t>(100, size_t(_options.min_time / elapsed * 1.2))) : 100;
+			}
+		}
+
+		void write(std::ostream& out) const {
+			if (_options.format == "csv") {
+				out << "group,name,impl,iterations,ns_per_op,allocs_per_op\n";
+				for (const auto& r : _results) {
+					out << r.group << "," << r.name << "," << r.impl << "," << r.iterations << "," << r.ns_per_op << "," << r.allocs_per_op << "\n";
+				}
+			} else if (_options.format == "json") {
+				out << "[\n";
+				for (size_t i = 0; i < _results.size(); ++i) {
+					const auto& r = _results[i];
+					out << "  { \"group\": \"" << r.group << "\", \"name\": \"" << r.name << "\", \"impl\": \"" << r.impl
+						<< "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+						<< ", \"allocs_per_op\": " << r.allocs_per_op << " }" << (i + 1 < _results.size() ? "," : "") << "\n";
+				}
+				out << "]\n";
+			} else {
+				out << std::left << std::setw(12) << "group" << std::setw(28) << "name" << std::setw(8) << "impl"
+					<< std::right << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op" << "\n";
+				for (const auto& r : _results) {
+					out << std::left << std::setw(12) << r.group << std::setw(28) << r.name << std::setw(8) << r.impl
+						<< std::right << std::setw(12) << std::fixed << std::setprecision(2) << r.ns_per_op
+						<< std::setw(12) << r.allocs_per_op << "\n";
+				}
+			}
+		}
+
+		void write() const {
+			if (_options.out.empty()) {
+				write(std::cout);
+				return;
+			}
+			std::ofstream file(_options.out);
+			if (!file.is_open()) {
+				throw std::ios_base::failure("Failed to open file: " + _options.out);
+			}
+			write(file);
+		}
+	};
+}
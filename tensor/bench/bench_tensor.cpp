@@ -0,0 +1,259 @@
+#include <cmath>
+#include "../object.h"
+#include "../quat.h"
+#include "bench.h"
+
+/*
+	Micro-benchmarks of the tensor kernels against Eigen::Matrix3d
+	usage: bench_tensor [--format=table|csv|json] [--out=file] [--min-time=seconds] [--filter=group/name]
+	build: bench_tensor.cpp alloc_counter.cpp ../utils.cpp (C++20, Eigen in the include path)
+*/
+
+std::mt19937 gen(42);
+std::uniform_real_distribution<double> unidistr(0.0, 1.0);
+
+namespace {
+	using namespace tens;
+	using bench::do_not_optimize;
+
+	// ------- for DIM == 3 : {00, 11, 22, 12, 02, 01, 21, 20, 10}
+	Eigen::Matrix3d to_eigen(const M3x3<double>& M) {
+		Eigen::Matrix3d m;
+		m << M[0], M[5], M[4], M[8], M[1], M[3], M[7], M[6], M[2];
+		return m;
+	}
+
+	Eigen::Vector3d to_eigen(const container<double, 3, 1>& a) {
+		return Eigen::Vector3d(a[0], a[1], a[2]);
+	}
+
+	double diff(const M3x3<double>& lhs, const Eigen::Matrix3d& rhs) {
+		return (to_eigen(lhs) - rhs).cwiseAbs().maxCoeff();
+	}
+
+	double diff(const container<double, 3, 1>& lhs, const Eigen::Vector3d& rhs) {
+		return (to_eigen(lhs) - rhs).cwiseAbs().maxCoeff();
+	}
+
+	double diff(double lhs, double rhs) {
+		return std::abs(lhs - rhs);
+	}
+
+	// both implementations must agree before they are timed, a mismatch fails the run
+	size_t mismatches = 0;
+
+	void check(const std::string& name, double d) {
+		if (!(d < 1e-8)) {
+			mismatches++;
+			std::cerr << "bench: results of '" << name << "' differ from Eigen by " << d << std::endl;
+		}
+	}
+
+	// symmetric positive definite matrix (log/sqrt/eigen inputs)
+	M3x3<double> spd_matrix() {
+		const auto A = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		auto S = A * A.transpose();
+		return S += Matrix<double, 3>(FILL_TYPE::INDENT);
+	}
+
+	void bench_kernels(bench::Suite& suite) {
+		const auto A = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		const auto B = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		const auto a = Array<double, 3>(FILL_TYPE::RANDOM);
+		const auto b = Array<double, 3>(FILL_TYPE::RANDOM);
+		const Eigen::Matrix3d eA = to_eigen(A), eB = to_eigen(B);
+		const Eigen::Vector3d ea = to_eigen(a), eb = to_eigen(b);
+		M3x3<double> R;
+		container<double, 3, 1> r;
+		Eigen::Matrix3d eR;
+		Eigen::Vector3d er;
+		double s;
+
+		math::dim3::mat_scal_mat(A.data(), B.data(), R.data());
+		check("mat_scal_mat", diff(R, eA * eB));
+		suite.run("kernel", "mat_scal_mat", "tensor", [&] { do_not_optimize(A); math::dim3::mat_scal_mat(A.data(), B.data(), R.data()); do_not_optimize(R); });
+		suite.run("kernel", "mat_scal_mat", "eigen", [&] { do_not_optimize(eA); eR.noalias() = eA * eB; do_not_optimize(eR); });
+
+		math::dim3::mat_scal_mat_transp(A.data(), B.data(), R.data());
+		check("mat_scal_mat_transp", diff(R, eA * eB.transpose()));
+		suite.run("kernel", "mat_scal_mat_transp", "tensor", [&] { do_not_optimize(A); math::dim3::mat_scal_mat_transp(A.data(), B.data(), R.data()); do_not_optimize(R); });
+		suite.run("kernel", "mat_scal_mat_transp", "eigen", [&] { do_not_optimize(eA); eR.noalias() = eA * eB.transpose(); do_not_optimize(eR); });
+
+		check("mat_conv_transp", diff(math::dim3::mat_conv_transp(A.data(), B.data()), eA.cwiseProduct(eB.transpose()).sum()));
+		suite.run("kernel", "mat_conv_transp", "tensor", [&] { do_not_optimize(A); s = math::dim3::mat_conv_transp(A.data(), B.data()); do_not_optimize(s); });
+		suite.run("kernel", "mat_conv_transp", "eigen", [&] { do_not_optimize(eA); s = eA.cwiseProduct(eB.transpose()).sum(); do_not_optimize(s); });
+
+		math::dim3::mat_scal_vect(A.data(), a.data(), r.data());
+		check("mat_scal_vect", diff(r, eA * ea));
+		suite.run("kernel", "mat_scal_vect", "tensor", [&] { do_not_optimize(A); math::dim3::mat_scal_vect(A.data(), a.data(), r.data()); do_not_optimize(r); });
+		suite.run("kernel", "mat_scal_vect", "eigen", [&] { do_not_optimize(eA); er.noalias() = eA * ea; do_not_optimize(er); });
+
+		math::dim3::vect_scal_mat(a.data(), A.data(), r.data());
+		check("vect_scal_mat", diff(r, Eigen::Vector3d(ea.transpose() * eA)));
+		suite.run("kernel", "vect_scal_mat", "tensor", [&] { do_not_optimize(A); math::dim3::vect_scal_mat(a.data(), A.data(), r.data()); do_not_optimize(r); });
+		suite.run("kernel", "vect_scal_mat", "eigen", [&] { do_not_optimize(eA); er.noalias() = eA.transpose() * ea; do_not_optimize(er); });
+
+		check("vect_scal_vect", diff(math::dim3::vect_scal_vect(a.data(), b.data()), ea.dot(eb)));
+		suite.run("kernel", "vect_scal_vect", "tensor", [&] { do_not_optimize(a); s = math::dim3::vect_scal_vect(a.data(), b.data()); do_not_optimize(s); });
+		suite.run("kernel", "vect_scal_vect", "eigen", [&] { do_not_optimize(ea); s = ea.dot(eb); do_not_optimize(s); });
+
+		check("det_mat", diff(math::dim3::det_mat(A.data()), eA.determinant()));
+		suite.run("kernel", "det_mat", "tensor", [&] { do_not_optimize(A); s = math::dim3::det_mat(A.data()); do_not_optimize(s); });
+		suite.run("kernel", "det_mat", "eigen", [&] { do_not_optimize(eA); s = eA.determinant(); do_not_optimize(s); });
+
+		math::dim3::inv_mat(A.data(), R.data());
+		check("inv_mat", diff(R, eA.inverse()));
+		suite.run("kernel", "inv_mat", "tensor", [&] { do_not_optimize(A); math::dim3::inv_mat(A.data(), R.data()); do_not_optimize(R); });
+		suite.run("kernel", "inv_mat", "eigen", [&] { do_not_optimize(eA); eR = eA.inverse(); do_not_optimize(eR); });
+	}
+
+	void bench_container(bench::Suite& suite) {
+		const auto A = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		const auto B = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		const Eigen::Matrix3d eA = to_eigen(A), eB = to_eigen(B);
+		M3x3<double> R;
+		Eigen::Matrix3d eR;
+		double s;
+
+		check("add", diff(A + B, eA + eB));
+		suite.run("container", "add", "tensor", [&] { do_not_optimize(A); R = A + B; do_not_optimize(R); });
+		suite.run("container", "add", "eigen", [&] { do_not_optimize(eA); eR = eA + eB; do_not_optimize(eR); });
+
+		check("sub", diff(A - B, eA - eB));
+		suite.run("container", "sub", "tensor", [&] { do_not_optimize(A); R = A - B; do_not_optimize(R); });
+		suite.run("container", "sub", "eigen", [&] { do_not_optimize(eA); eR = eA - eB; do_not_optimize(eR); });
+
+		check("mul", diff(A * B, eA * eB));
+		suite.run("container", "mul", "tensor", [&] { do_not_optimize(A); R = A * B; do_not_optimize(R); });
+		suite.run("container", "mul", "eigen", [&] { do_not_optimize(eA); eR.noalias() = eA * eB; do_not_optimize(eR); });
+
+		check("mul_assign", diff(M3x3<double>(A) *= B, eA * eB));
+		suite.run("container", "mul_assign", "tensor", [&] { R = A; do_not_optimize(R); R *= B; do_not_optimize(R); });
+		suite.run("container", "mul_assign", "eigen", [&] { eR = eA; do_not_optimize(eR); eR *= eB; do_not_optimize(eR); });
+
+		check("scalar_mul", diff(A * 2.5, eA * 2.5));
+		suite.run("container", "scalar_mul", "tensor", [&] { do_not_optimize(A); R = A * 2.5; do_not_optimize(R); });
+		suite.run("container", "scalar_mul", "eigen", [&] { do_not_optimize(eA); eR = eA * 2.5; do_not_optimize(eR); });
+
+		check("transpose", diff(A.transpose(), eA.transpose()));
+		suite.run("container", "transpose", "tensor", [&] { do_not_optimize(A); R = A.transpose(); do_not_optimize(R); });
+		suite.run("container", "transpose", "eigen", [&] { do_not_optimize(eA); eR = eA.transpose(); do_not_optimize(eR); });
+
+		check("inverse", diff(A.inverse(), eA.inverse()));
+		suite.run("container", "inverse", "tensor", [&] { do_not_optimize(A); R = A.inverse(); do_not_optimize(R); });
+		suite.run("container", "inverse", "eigen", [&] { do_not_optimize(eA); eR = eA.inverse(); do_not_optimize(eR); });
+
+		check("det", diff(A.det(), eA.determinant()));
+		suite.run("container", "det", "tensor", [&] { do_not_optimize(A); s = A.det(); do_not_optimize(s); });
+		suite.run("container", "det", "eigen", [&] { do_not_optimize(eA); s = eA.determinant(); do_not_optimize(s); });
+	}
+
+	void bench_spectral(bench::Suite& suite) {
+		const auto S = spd_matrix();
+		const Eigen::Matrix3d eS = to_eigen(S);
+		std::pair<M3x3<double>, M3x3<double>> eig;
+		M3x3<double> R;
+		Eigen::Matrix3d eR;
+		Eigen::Vector3d el;
+
+		// eigen values are compared as a sorted set
+		{
+			eig = eigen(S);
+			std::array<double, 3> l = { eig.first[0], eig.first[1], eig.first[2] };
+			std::sort(l.begin(), l.end());
+			const Eigen::Vector3d ref = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>(eS).eigenvalues();
+			check("eigen", (Eigen::Vector3d(l[0], l[1], l[2]) - ref).cwiseAbs().maxCoeff());
+		}
+		suite.run("spectral", "eigen", "tensor", [&] { do_not_optimize(S); eig = eigen(S); do_not_optimize(eig); });
+		suite.run("spectral", "eigen", "eigen", [&] {
+			do_not_optimize(eS);
+			Eigen::EigenSolver<Eigen::Matrix3d> es(eS, true);
+			do_not_optimize(es.eigenvalues());
+		});
+		suite.run("spectral", "eigen_selfadjoint", "eigen", [&] {
+			do_not_optimize(eS);
+			Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es(eS);
+			do_not_optimize(es.eigenvalues());
+		});
+
+		const auto reference = [&](double(&f)(double)) {
+			Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es(eS);
+			el = es.eigenvalues().unaryExpr([&](double x) { return f(x); });
+			return Eigen::Matrix3d(es.eigenvectors() * el.asDiagonal() * es.eigenvectors().transpose());
+		};
+		check("func_log", diff(func(S, std::log), reference(std::log)));
+		suite.run("spectral", "func_log", "tensor", [&] { do_not_optimize(S); R = func(S, std::log); do_not_optimize(R); });
+		suite.run("spectral", "func_log", "eigen", [&] { do_not_optimize(eS); eR = reference(std::log); do_not_optimize(eR); });
+
+		check("func_sqrt", diff(func(S, std::sqrt), reference(std::sqrt)));
+		suite.run("spectral", "func_sqrt", "tensor", [&] { do_not_optimize(S); R = func(S, std::sqrt); do_not_optimize(R); });
+		suite.run("spectral", "func_sqrt", "eigen", [&] { do_not_optimize(eS); eR = reference(std::sqrt); do_not_optimize(eR); });
+	}
+
+	void bench_object(bench::Suite& suite) {
+		const auto A1 = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		const auto A2 = Matrix<double, 3>(FILL_TYPE::RANDOM);
+		const auto b1 = create_basis<double, 3>(DEFAULT_ORTH_BASIS::RANDOM);
+		const auto b2 = create_basis<double, 3>(DEFAULT_ORTH_BASIS::RANDOM);
+		const auto t1 = Tensor<double, 3>(A1, b1);
+		const auto t2 = Tensor<double, 3>(A2, b2);
+		const auto t3 = Tensor<double, 3>(A2, b1);
+		const Eigen::Matrix3d eA1 = to_eigen(A1), eA2 = to_eigen(A2), eB1 = to_eigen(*b1), eB2 = to_eigen(*b2);
+		M3x3<double> R;
+		Eigen::Matrix3d eR;
+
+		// t1 * t2: components of t2 at basis of t1 (op = B2.B1^T, op^T.A2.op), then product of components
+		const auto reference = [&] {
+			const Eigen::Matrix3d op = eB2 * eB1.transpose();
+			return Eigen::Matrix3d(eA1 * (op.transpose() * eA2 * op));
+		};
+		check("cross_basis_mul", diff((t1 * t2).get_comp_ref(), reference()));
+		suite.run("object", "cross_basis_mul", "tensor", [&] { do_not_optimize(t1); auto t = t1 * t2; do_not_optimize(t.get_comp_ref()); });
+		suite.run("object", "cross_basis_mul", "eigen", [&] { do_not_optimize(eA1); eR = reference(); do_not_optimize(eR); });
+
+		check("same_basis_mul", diff((t1 * t3).get_comp_ref(), eA1 * eA2));
+		suite.run("object", "same_basis_mul", "tensor", [&] { do_not_optimize(t1); auto t = t1 * t3; do_not_optimize(t.get_comp_ref()); });
+
+		check("get_comp_at_basis", diff(t2.get_comp_at_basis(b1), [&] { const Eigen::Matrix3d op = eB2 * eB1.transpose(); return Eigen::Matrix3d(op.transpose() * eA2 * op); }()));
+		suite.run("object", "get_comp_at_basis", "tensor", [&] { do_not_optimize(t2); R = t2.get_comp_at_basis(b1); do_not_optimize(R); });
+		suite.run("object", "get_comp_at_basis", "eigen", [&] {
+			do_not_optimize(eA2);
+			const Eigen::Matrix3d op = eB2 * eB1.transpose();
+			eR.noalias() = op.transpose() * eA2 * op;
+			do_not_optimize(eR);
+		});
+
+		suite.run("object", "copy", "tensor", [&] { do_not_optimize(t1); auto t = t1; do_not_optimize(t.get_comp_ref()); });
+	}
+
+	void bench_quat(bench::Suite& suite) {
+		container<double, 4, 1> c1, c2;
+		c1.fill_rand(); c2.fill_rand();
+		const quat<double> q1(c1), q2(c2);
+		const Eigen::Quaterniond e1(c1[0], c1[1], c1[2], c1[3]), e2(c2[0], c2[1], c2[2], c2[3]);
+		quat<double> q;
+		Eigen::Quaterniond e;
+
+		q = q1 * q2;
+		e = e1 * e2;
+		check("quat_mul", std::max({ diff(q[0], e.w()), diff(q[1], e.x()), diff(q[2], e.y()), diff(q[3], e.z()) }));
+		suite.run("quat", "mul", "tensor", [&] { do_not_optimize(q1); q = q1 * q2; do_not_optimize(q); });
+		suite.run("quat", "mul", "eigen", [&] { do_not_optimize(e1); e = e1 * e2; do_not_optimize(e); });
+	}
+}
+
+int main(int argc, char** argv) {
+	const auto options = bench::Options::parse(argc, argv);
+	bench::Suite suite(options);
+	bench_kernels(suite);
+	bench_container(suite);
+	bench_spectral(suite);
+	bench_object(suite);
+	bench_quat(suite);
+	suite.write();
+	if (mismatches > 0) {
+		std::cerr << "bench: " << mismatches << " case(s) differ from Eigen" << std::endl;
+		return 1;
+	}
+	return 0;
+}
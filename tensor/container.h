@@ -9,6 +9,7 @@
 #include <utility>
 #include "error.h"
 #include "math.h"
+#include "profile.h"
 #include <Eigen/Dense>
 #include <Eigen/Eigenvalues>
 
@@ -22,7 +23,7 @@ namespace tens {
 	}
 
 	template<typename T, size_t DIM, size_t RANK>
-	concept FloatPoint = std::floating_point<T>;
+	concept FloatPoint = std::floating_point<T> || ad::is_dual_v<T>; // dual numbers of forward mode AD (see dual.h)
 
 	enum class FILL_TYPE {
 		ZERO,
@@ -53,7 +54,7 @@ namespace tens {
 			arr[8] = matrix[1][0];
 			return container<T, DIM, RANK>(arr);
 		}
-		throw new NoImplemetationYet();
+		throw NoImplemetationYet();
 	}
 	
 	template<typename T, size_t DIM, size_t RANK = 2>
@@ -72,6 +73,7 @@ namespace tens {
 	}
 
 	container<double, 3, 2> generate_rand_ort();
+	container<double, 3, 2> generate_rand_ort(std::mt19937& engine); // thread-safe with own engine
 	container<double, 3, 2> generate_indent_ort();
 
 	template<typename T, size_t DIM, size_t RANK>
@@ -211,7 +213,7 @@ namespace tens {
 			const T mul = T(1) / div;
 #ifdef _DEBUG
 			if (math::is_small_value(div)) {
-				throw new ErrorMath::DivisionByZero();
+				throw ErrorMath::DivisionByZero();
 			}
 #endif
 			for (size_t i = 0; i < lhs.size(); ++i)
@@ -253,7 +255,7 @@ namespace tens {
 		container<T, DIM, RANK>& operator /= (const T& div) {
 #ifdef _DEBUG
 			if (math::is_small_value(div)) {
-				throw new ErrorMath::DivisionByZero();
+				throw ErrorMath::DivisionByZero();
 			}
 #endif
 			const T mul = T(1) / div;
@@ -318,6 +320,7 @@ namespace tens {
 		}
 
 		[[nodiscard]] container<T, DIM, RANK> inverse() const {
+			TENS_PROFILE_SCOPE(INVERSE);
 			if (DIM == 3) {
 				container<T, DIM, RANK> inv_matr;
 				math::dim3::inv_mat(this->data(), inv_matr.data());
@@ -403,6 +406,7 @@ namespace tens {
 			throw NoImplemetationYet();
 		}
 #endif
+		TENS_PROFILE_SCOPE(EIGEN);
 		Eigen::Matrix3d m;
 		m << M[0], M[5], M[4], M[8], M[1], M[3], M[7], M[6], M[2];
 		auto es = Eigen::EigenSolver<Eigen::Matrix3d>(m, true);
@@ -455,6 +459,43 @@ namespace tens {
 		return { comp , basis };
 	}
 
+	/*
+		eigen values and vectors of a symmetric matrix of dual numbers: values of the eigen problem of the values of M,
+		derivatives by the perturbation theory, for A = B.dM.Bt (B - eigen vectors, rows)
+			dl_i = A_ii, dv_i = sum_j!=i A_ji / (l_i - l_j) * v_j
+		terms of equal eigen values are dropped (the eigen basis of a multiple eigen value is not unique)
+	*/
+	template<typename T, size_t N, size_t DIM, size_t RANK>
+	std::pair<container<ad::Dual<T, N>, DIM, RANK>, container<ad::Dual<T, N>, DIM, RANK>> eigen(const tens::container<ad::Dual<T, N>, DIM, RANK>& M) {
+		using math::dim3::IDX;
+		container<T, DIM, RANK> m;
+		for (size_t c = 0; c < m.size(); ++c) m[c] = M[c].v;
+		const auto p = eigen(m);
+
+		container<ad::Dual<T, N>, DIM, RANK> comp;
+		container<ad::Dual<T, N>, DIM, RANK> basis;
+		for (size_t c = 0; c < m.size(); ++c) {
+			comp[c] = p.first[c];
+			basis[c] = p.second[c];
+		}
+		container<T, DIM, RANK> dm, temp, A;
+		for (size_t k = 0; k < N; ++k) {
+			for (size_t c = 0; c < m.size(); ++c) dm[c] = M[c].d[k];
+			math::dim3::mat_scal_mat(p.second.data(), dm.data(), temp.data());
+			math::dim3::mat_scal_mat_transp(temp.data(), p.second.data(), A.data());
+			for (size_t i = 0; i < DIM; ++i) {
+				comp[i].d[k] = A[IDX[i][i]];
+				for (size_t j = 0; j < DIM; ++j) {
+					const T gap = p.first[i] - p.first[j];
+					if (i == j || math::is_small_value(gap)) continue;
+					const T coef = A[IDX[j][i]] / gap;
+					for (size_t c = 0; c < DIM; ++c) basis[IDX[i][c]].d[k] += coef * p.second[IDX[j][c]];
+				}
+			}
+		}
+		return { comp, basis };
+	}
+
 	template<typename T, size_t DIM, size_t RANK = 2>
 	std::array<container<T, DIM, 1>, DIM> slice_basis_to_vects(const tens::container<T, DIM, RANK>& basis) {
 #ifdef _DEBUG
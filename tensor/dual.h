@@ -0,0 +1,184 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <type_traits>
+
+namespace math {
+	template<typename T> bool is_not_small_value(T value);
+	template<typename T> bool is_small_value(T value);
+}
+
+namespace ad {
+	/*
+		Dual number of the forward mode automatic differentiation: a value and N directional derivatives
+		stored contiguously after it (trivially copyable, containers copy it by memcpy)
+		x = make_variable(value, k) seeds the direction k, f(x).d[k] is df/dx
+	*/
+	template<typename T, size_t N>
+	struct Dual {
+		using value_type = T;
+		static constexpr size_t directions = N;
+
+		T v{};
+		std::array<T, N> d{};
+
+		Dual() = default;
+		// constant
+		Dual(T value) : v(value) {};
+
+		Dual& operator += (const Dual& rhs) {
+			v += rhs.v;
+			for (size_t k = 0; k < N; ++k) d[k] += rhs.d[k];
+			return *this;
+		}
+		Dual& operator -= (const Dual& rhs) {
+			v -= rhs.v;
+			for (size_t k = 0; k < N; ++k) d[k] -= rhs.d[k];
+			return *this;
+		}
+		Dual& operator *= (const Dual& rhs) {
+			for (size_t k = 0; k < N; ++k) d[k] = d[k] * rhs.v + v * rhs.d[k];
+			v *= rhs.v;
+			return *this;
+		}
+		Dual& operator /= (const Dual& rhs) {
+			const T inv = T(1) / rhs.v;
+			v *= inv;
+			for (size_t k = 0; k < N; ++k) d[k] = (d[k] - v * rhs.d[k]) * inv;
+			return *this;
+		}
+		Dual& operator += (T rhs) { v += rhs; return *this; }
+		Dual& operator -= (T rhs) { v -= rhs; return *this; }
+		Dual& operator *= (T rhs) {
+			v *= rhs;
+			for (size_t k = 0; k < N; ++k) d[k] *= rhs;
+			return *this;
+		}
+		Dual& operator /= (T rhs) { return *this *= T(1) / rhs; }
+
+		friend Dual operator - (Dual x) {
+			x.v = -x.v;
+			for (size_t k = 0; k < N; ++k) x.d[k] = -x.d[k];
+			return x;
+		}
+		friend Dual operator + (const Dual& x) { return x; }
+
+		friend Dual operator + (Dual lhs, const Dual& rhs) { return lhs += rhs; }
+		friend Dual operator - (Dual lhs, const Dual& rhs) { return lhs -= rhs; }
+		friend Dual operator * (Dual lhs, const Dual& rhs) { return lhs *= rhs; }
+		friend Dual operator / (Dual lhs, const Dual& rhs) { return lhs /= rhs; }
+		friend Dual operator + (Dual lhs, T rhs) { return lhs += rhs; }
+		friend Dual operator - (Dual lhs, T rhs) { return lhs -= rhs; }
+		friend Dual operator * (Dual lhs, T rhs) { return lhs *= rhs; }
+		friend Dual operator / (Dual lhs, T rhs) { return lhs /= rhs; }
+		friend Dual operator + (T lhs, Dual rhs) { return rhs += lhs; }
+		friend Dual operator - (T lhs, const Dual& rhs) { return -rhs + lhs; }
+		friend Dual operator * (T lhs, Dual rhs) { return rhs *= lhs; }
+		friend Dual operator / (T lhs, const Dual& rhs) { return Dual(lhs) /= rhs; }
+
+		// comparisons are by values
+		friend bool operator == (const Dual& lhs, const Dual& rhs) { return lhs.v == rhs.v; }
+		friend bool operator != (const Dual& lhs, const Dual& rhs) { return lhs.v != rhs.v; }
+		friend bool operator < (const Dual& lhs, const Dual& rhs) { return lhs.v < rhs.v; }
+		friend bool operator > (const Dual& lhs, const Dual& rhs) { return lhs.v > rhs.v; }
+		friend bool operator <= (const Dual& lhs, const Dual& rhs) { return lhs.v <= rhs.v; }
+		friend bool operator >= (const Dual& lhs, const Dual& rhs) { return lhs.v >= rhs.v; }
+
+		friend std::ostream& operator << (std::ostream& out, const Dual& x) {
+			out << x.v << " [";
+			for (size_t k = 0; k < N; ++k) out << (k ? ", " : "") << x.d[k];
+			return out << "]";
+		}
+	};
+
+	template<typename T>
+	struct is_dual : std::false_type {};
+
+	template<typename T, size_t N>
+	struct is_dual<Dual<T, N>> : std::true_type {};
+
+	template<typename T>
+	inline constexpr bool is_dual_v = is_dual<T>::value;
+
+	// the value without derivatives (the scalar itself for floating point types)
+	template<typename T>
+	T value(const T& x) { return x; }
+
+	template<typename T, size_t N>
+	T value(const Dual<T, N>& x) { return x.v; }
+
+	// variable of the direction k
+	template<size_t N, typename T>
+	Dual<T, N> make_variable(T value, size_t k) {
+		Dual<T, N> x(value);
+		x.d[k] = T(1);
+		return x;
+	}
+
+	// f(x) by the value f and the derivative df at x.v
+	template<typename T, size_t N>
+	Dual<T, N> chain(const Dual<T, N>& x, T f, T df) {
+		Dual<T, N> res(f);
+		for (size_t k = 0; k < N; ++k) res.d[k] = df * x.d[k];
+		return res;
+	}
+
+	// elementary functions take the argument by value, so they bind to T(&)(T) (see tens::func)
+	template<typename T, size_t N>
+	Dual<T, N> sqrt(Dual<T, N> x) {
+		const T s = std::sqrt(x.v);
+		return chain(x, s, T(0.5) / s);
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> exp(Dual<T, N> x) {
+		const T e = std::exp(x.v);
+		return chain(x, e, e);
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> log(Dual<T, N> x) {
+		return chain(x, std::log(x.v), T(1) / x.v);
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> sin(Dual<T, N> x) {
+		return chain(x, std::sin(x.v), std::cos(x.v));
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> cos(Dual<T, N> x) {
+		return chain(x, std::cos(x.v), -std::sin(x.v));
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> abs(Dual<T, N> x) {
+		return x.v < T(0) ? -x : x;
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> fabs(Dual<T, N> x) {
+		return abs(x);
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> pow(const Dual<T, N>& x, T p) {
+		const T xp = std::pow(x.v, p);
+		return chain(x, xp, p == T(0) ? T(0) : p * std::pow(x.v, p - T(1)));
+	}
+
+	template<typename T, size_t N>
+	Dual<T, N> copysign(const Dual<T, N>& x, const Dual<T, N>& sign) {
+		return std::signbit(x.v) == std::signbit(sign.v) ? x : -x;
+	}
+}
+
+namespace math {
+	template<typename T, size_t N>
+	bool is_small_value(const ad::Dual<T, N>& value) { return is_small_value(value.v); }
+
+	template<typename T, size_t N>
+	bool is_not_small_value(const ad::Dual<T, N>& value) { return is_not_small_value(value.v); }
+}
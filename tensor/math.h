@@ -1,5 +1,6 @@
 #pragma once
 #include "error.h"
+#include "dual.h"
 
 namespace math {
 
@@ -7,6 +8,9 @@ namespace math {
 	template<typename T> bool is_small_value(T value);
 
 	namespace dim3 {
+		// container index of the component (i, j), layout { 00, 11, 22, 12, 02, 01, 21, 20, 10 }
+		constexpr size_t IDX[3][3] = { { 0, 5, 4 }, { 8, 1, 3 }, { 7, 6, 2 } };
+
 		template<typename T>
 		inline void mat_scal_mat_transp(const T* lhs, const T* rhs, T* nhs) {
 			nhs[0] = lhs[0] * rhs[0] + lhs[4] * rhs[4] + lhs[5] * rhs[5];
@@ -12,7 +12,7 @@ namespace tens {
 	template<typename T, size_t DIM, size_t RANK = 2>
 	object<T, DIM, RANK> Tensor(const container<T, DIM, RANK>& m, const Basis<T,DIM>& _basis) {
 		if (RANK != 2) {
-			throw new NoImplemetationYet();
+			throw NoImplemetationYet();
 		}
 		return object<T, DIM, RANK>(m, _basis);
 	}
@@ -35,7 +35,7 @@ namespace tens {
 	template<typename T, size_t DIM, size_t RANK = 1>
 	object<T, DIM, RANK> Vector(const container<T, DIM, RANK>& a, const Basis<T,DIM>& _basis) {
 		if (RANK != 1) {
-			throw new NoImplemetationYet();
+			throw NoImplemetationYet();
 		}
 		return object<T, DIM, RANK>(a, _basis);
 	}
@@ -43,7 +43,7 @@ namespace tens {
 	template<typename T, size_t DIM, size_t RANK= 1>
 	object<T, DIM, RANK> Vector(const object<T, DIM, RANK>& v) {
 		if (RANK != 1) {
-			throw new NoImplemetationYet();
+			throw NoImplemetationYet();
 		}
 		return object<T, DIM, RANK>(v);
 	}
@@ -59,44 +59,95 @@ namespace tens {
 	template<typename T, size_t DIM, size_t RANK = 2>
 	static const std::shared_ptr<container<T, DIM, RANK>> EMPTY_BASIS = std::shared_ptr<container<T, DIM, RANK>>();
 
+	/*
+		components are copy-on-write: copies share components until one of them is written,
+		a write to shared components makes own copy of them (see _write)
+		components referenced from outside (see comp(), e.g. values of measures) are pinned: they are never shared
+		a copy gets own basis as before, so changes of the basis in place (recalc_basis) are seen
+		by all objects built on the same basis and by no copies
+		sharing is not synchronized: a copy must not be written concurrently with other copies
+	*/
 	template<typename T, size_t DIM, size_t RANK>
 	class object {
 
-		std::unique_ptr<container<T, DIM, RANK>> _comp;
+		std::shared_ptr<container<T, DIM, RANK>> _comp;
 		Basis<T, DIM> _basis;
+		bool _pinned = false; // a reference to components is given out
+
+		// components of the source: shared or own copy if the source is pinned
+		static std::shared_ptr<container<T, DIM, RANK>> _share(const object<T, DIM, RANK>& src) {
+			return src._pinned ? std::make_shared<container<T, DIM, RANK>>(*src._comp) : src._comp;
+		}
+
+		// components for writing
+		container<T, DIM, RANK>& _write() {
+			if (_comp.use_count() > 1) {
+				_comp = std::make_shared<container<T, DIM, RANK>>(*_comp);
+			}
+			return *_comp;
+		}
+
+		// new value of components, shared components are not copied before
+		void _assign(const container<T, DIM, RANK>& value) {
+			if (_comp.use_count() > 1) {
+				_comp = std::make_shared<container<T, DIM, RANK>>(value);
+			} else {
+				*_comp = value;
+			}
+		}
 
 		void _copy(const object<T, DIM, RANK>& src) {
-			if (_basis == nullptr) { // it has no object, so we create it
-				_comp = std::make_unique<container<T, DIM, RANK>>(container<T, DIM, RANK>(*src._comp));
+			if (_basis == nullptr) { // it has no object, so share comp and create own basis
+				if (_pinned) {
+					*_comp = *src._comp;
+				} else {
+					_comp = _share(src);
+				}
 				if (src._basis) {
-					_basis = std::make_shared<container<T, DIM, 2>>(container<T, DIM, 2>(*src._basis));
+					_basis = std::make_shared<container<T, DIM, 2>>(*src._basis);
 				}
 			}
 			else { // has object, recalc comp at this object if it is necessery
-				if (_basis == src._basis) { // object is the same, just copy comp
-					*_comp = *src._comp;
+				if (_basis == src._basis) { // object is the same, just share comp
+					if (_pinned) {
+						*_comp = *src._comp;
+					} else if (_comp != src._comp) {
+						_comp = _share(src);
+					}
 				}
 				else { // other object - recalc comp
-					*_comp = src.get_comp_at_basis(*this);
+					_assign(src.get_comp_at_basis(*this));
 				}
 			}
 		}
 
 		void _move(object<T, DIM, RANK>&& src) {
 			if (_basis == nullptr) { // it has no object, so move all
-				_comp = std::move(src._comp);
+				if (_pinned) {
+					*_comp = *src._comp;
+					src._comp.reset();
+				} else {
+					_comp = std::move(src._comp);
+					_pinned = src._pinned; // references to the moved comp are kept
+				}
 				_basis = std::move(src._basis);
 			}
 			else { // has object
-				if (_basis == src._basis) { // the same => move only comp
+				if (_basis == src._basis && !_pinned) { // the same => move only comp
 					_comp = std::move(src._comp);
+					_pinned = src._pinned; // references to the moved comp are kept
+				}
+				else if (_basis == src._basis) { // pinned comp is kept
+					*_comp = *src._comp;
+					src._comp.reset();
 				}
 				else { // recalc comp and reset src
-					*_comp = src.get_comp_at_basis(*this);
+					_assign(src.get_comp_at_basis(*this));
 					src._comp.reset();
 				}
 				src._basis.reset(); // reset src object
 			}
+			src._pinned = false;
 		}
 
 		void _reset_basis(const Basis<T, DIM>& pbasis) {
@@ -105,7 +156,7 @@ namespace tens {
 		}
 
 		object(const container<T, DIM, RANK>& comp, const container<T, DIM, RANK>& basis) {
-			_comp = std::make_unique<container<T, DIM, RANK>>(comp);
+			_comp = std::make_shared<container<T, DIM, RANK>>(comp);
 			_basis = std::make_shared<container<T, DIM, 2>>(basis);
 		}
 	protected:
@@ -118,8 +169,10 @@ namespace tens {
 			return mat_scal_mat_transp(*this->_basis, *object);
 		}
 
+		// writable reference to own components, they are never shared after that
 		container<T, DIM, RANK>& comp() {
-			return *this->_comp;
+			_pinned = true;
+			return _write();
 		}
 		Basis<T, DIM>& basis() {
 			return this->_basis;
@@ -137,22 +190,22 @@ namespace tens {
 		}
 
 		object(FILL_TYPE type, Basis<T, DIM>&& pbasis) {
-			_comp = std::make_unique<container<T, DIM, RANK>>(container<T, DIM, RANK>(type));
+			_comp = std::make_shared<container<T, DIM, RANK>>(container<T, DIM, RANK>(type));
 			_basis = std::move(pbasis);
 		}
 
 		object(FILL_TYPE type = FILL_TYPE::ZERO, const Basis<T, DIM>& pbasis = EMPTY_BASIS<T, DIM>) {
-			_comp = std::make_unique<container<T, DIM, RANK>>(container<T, DIM, RANK>(type));
+			_comp = std::make_shared<container<T, DIM, RANK>>(container<T, DIM, RANK>(type));
 			if (RANK > 0) { _basis = pbasis; }
 		}
 
 		object(const container<T, DIM, RANK>& comp, const Basis<T, DIM>& pbasis = EMPTY_BASIS<T, DIM>) {
-			_comp = std::make_unique<container<T, DIM, RANK>>(comp);
+			_comp = std::make_shared<container<T, DIM, RANK>>(comp);
 			if (RANK > 0) { _basis = pbasis; }
 		}
 
 		object(const container<T, DIM, RANK>& comp, Basis<T, DIM>&& pbasis = EMPTY_BASIS<T, DIM>) {
-			_comp = std::make_unique<container<T, DIM, RANK>>(comp);
+			_comp = std::make_shared<container<T, DIM, RANK>>(comp);
 			if (RANK > 0) {
 				_basis = std::move(pbasis);
 			} else {
@@ -161,12 +214,12 @@ namespace tens {
 		}
 
 		object(container<T, DIM, RANK>&& comp, const Basis<T, DIM>& pbasis = EMPTY_BASIS<T, DIM>) noexcept {
-			_comp = std::make_unique<container<T, DIM, RANK>>(std::move(comp));
+			_comp = std::make_shared<container<T, DIM, RANK>>(std::move(comp));
 			if (RANK > 0) { _basis = pbasis; }
 		}
 		
 		object(container<T, DIM, RANK>&& comp, Basis<T, DIM>&& pbasis = EMPTY_BASIS<T, DIM>) noexcept {
-			_comp = std::make_unique<container<T, DIM, RANK>>(std::move(comp));
+			_comp = std::make_shared<container<T, DIM, RANK>>(std::move(comp));
 			if (RANK > 0) {
 				_basis = std::move(pbasis); 
 			} else {
@@ -179,15 +232,15 @@ namespace tens {
 		}
 
 		void change_basis(const Basis<T, DIM>& pbasis) {
-			*_comp = get_comp_at_basis(pbasis);
+			_assign(get_comp_at_basis(pbasis));
 			_reset_basis(pbasis);
 		}
 
 		void recalc_eigen_basis() {
 			recalc_basis(GLOBAL_BASIS<T, DIM>);
-			const auto eig = eigen(this->comp());
-			*this->_comp = eig.first;
-			*this->_basis = eig.second;
+			const auto eig = eigen(get_comp_ref());
+			_assign(eig.first);
+			*_basis = eig.second;
 		}
 
 		void recalc_basis(const object<T, DIM, RANK>& obj) {
@@ -195,7 +248,7 @@ namespace tens {
 		}
 
 		void recalc_basis(const Basis<T, DIM>& pbasis) {
-			*_comp = get_comp_at_basis(pbasis);
+			_assign(get_comp_at_basis(pbasis));
 			*_basis = *pbasis;
 		}
 
@@ -210,6 +263,7 @@ namespace tens {
 				return comp;
 			}
 			else {
+				TENS_PROFILE_SCOPE(CHANGE_BASIS);
 				container<T, DIM, 2> op = get_transform(pbasis);
 				if (RANK == 1) {
 					return operator*(comp, op);// comp * op;
@@ -248,42 +302,45 @@ namespace tens {
 		//}
 
 		object& operator *= (const T& mul) {
-			*this->_comp *= mul;
+			_write() *= mul;
 			return *this;
 		}
 
 		object& operator /= (const T& mul) {
-			*this->_comp /= mul;
+			_write() /= mul;
 			return *this;
 		}
 
 		object& operator *= (const object<T, DIM, RANK>& rhs) {
-			*this->_comp *= rhs.get_comp_at_basis(*this);
+			const auto rhsa = rhs.get_comp_at_basis(*this);
+			_write() *= rhsa;
 			return *this;
 		}
 
 		object& operator *= (const container<T, DIM, RANK>& rhs) {
-			*this->_comp *= rhs;
+			_write() *= rhs;
 			return *this;
 		}
 
 		object& operator += (const object<T, DIM, RANK>& rhs) {
-			*this->_comp += rhs.get_comp_at_basis(*this);
+			const auto rhsa = rhs.get_comp_at_basis(*this);
+			_write() += rhsa;
 			return *this;
 		}
 
 		object& operator += (const container<T, DIM, RANK>& rhs) {
-			*this->_comp += rhs;
+			_write() += rhs;
 			return *this;
 		}
 
 		object& operator -= (const object<T, DIM, RANK>& rhs) {
-			*this->_comp -= rhs.get_comp_at_basis(*this);
+			const auto rhsa = rhs.get_comp_at_basis(*this);
+			_write() -= rhsa;
 			return *this;
 		}
 
 		object& operator -= (const container<T, DIM, RANK>& rhs) {
-			*this->_comp -= rhs;
+			_write() -= rhs;
 			return *this;
 		}
 
@@ -295,7 +352,7 @@ namespace tens {
 		static friend object<T, DIM, RANK> operator * <> (const T& mul, const object<T, DIM, RANK>& rhs);
 
 		object& operator = (const container<T, DIM, RANK>& rhs) { // copy assign
-			*_comp = rhs;
+			_assign(rhs);
 			return *this;
 		}
 
@@ -334,15 +391,63 @@ namespace tens {
 		return object<T, DIM, LRANK + RRANK - 2>(lhs.get_comp_ref() * rhsa, lhs.get_basis_ref());
 	}
 
+	// f(M) = B^T.f(D).B for eigen values D and eigen basis B (rows), the same as the change of basis of the object (B, f(D)) to the global basis, without heap allocations
 	template<typename T, size_t DIM, size_t RANK>
 	container<T, DIM, RANK> func(const tens::container<T, DIM, RANK>& M, T(&f)(T)) {
 		auto p = eigen(M);
-		const size_t size = M.size();
 		for (size_t i = 0; i < DIM; i++)
 			p.first[i] = f(p.first[i]);
-		auto obj = object<T, DIM, RANK>(p.first, p.second);
-		obj.change_basis(GLOBAL_BASIS<T, DIM>);
-		return obj.comp();
+		auto res = p.second.transpose();
+		res *= p.first;
+		res *= p.second;
+		return res;
+	}
+
+	/*
+		f(M) of a symmetric matrix of dual numbers (Daleckii-Krein): for eigen values l and eigen vectors B (rows) of the values of M
+			dF = Bt.(G o (B.dM.Bt)).B, G_ij = (f(l_i) - f(l_j)) / (l_i - l_j), G_ii = f'(l_i)
+		f' is calculated by f itself at the dual eigen value
+	*/
+	template<typename T, size_t N, size_t DIM, size_t RANK>
+	container<ad::Dual<T, N>, DIM, RANK> func(const tens::container<ad::Dual<T, N>, DIM, RANK>& M, ad::Dual<T, N>(&f)(ad::Dual<T, N>)) {
+		using math::dim3::IDX;
+		container<T, DIM, RANK> m;
+		for (size_t c = 0; c < m.size(); ++c) m[c] = M[c].v;
+		const auto p = eigen(m);
+
+		std::array<T, DIM> fl, dfl;
+		for (size_t i = 0; i < DIM; ++i) {
+			const auto y = f(ad::make_variable<N>(p.first[i], 0));
+			fl[i] = y.v;
+			dfl[i] = y.d[0];
+		}
+		container<T, DIM, RANK> G;
+		for (size_t i = 0; i < DIM; ++i) {
+			for (size_t j = 0; j < DIM; ++j) {
+				const T gap = p.first[i] - p.first[j];
+				G[IDX[i][j]] = math::is_small_value(gap) ? (dfl[i] + dfl[j]) / 2 : (fl[i] - fl[j]) / gap;
+			}
+		}
+
+		container<ad::Dual<T, N>, DIM, RANK> res;
+		container<T, DIM, RANK> dm, temp, A;
+		auto value = p.second.transpose();
+		for (size_t i = 0; i < DIM; ++i) temp[IDX[i][i]] = fl[i];
+		for (size_t i = DIM; i < m.size(); ++i) temp[i] = T(0);
+		value *= temp;
+		value *= p.second;
+		for (size_t c = 0; c < m.size(); ++c) res[c] = value[c];
+		for (size_t k = 0; k < N; ++k) {
+			for (size_t c = 0; c < m.size(); ++c) dm[c] = M[c].d[k];
+			math::dim3::mat_scal_mat(p.second.data(), dm.data(), temp.data());
+			math::dim3::mat_scal_mat_transp(temp.data(), p.second.data(), A.data());
+			for (size_t c = 0; c < m.size(); ++c) A[c] *= G[c];
+			math::dim3::mat_scal_mat(A.data(), p.second.data(), temp.data());
+			value = p.second.transpose();
+			value *= temp;
+			for (size_t c = 0; c < m.size(); ++c) res[c].d[k] = value[c];
+		}
+		return res;
 	}
 
 	template<typename T, size_t DIM, size_t RANK = 2>
@@ -354,7 +459,7 @@ namespace tens {
 			diag += I[diagIdx];
 		for (size_t nonDiagIdx = 3; nonDiagIdx < 9; nonDiagIdx++)
 			nondiag += I[nonDiagIdx];
-		return (math::is_small_value<T>(abs(diag - (T)DIM) + abs(nondiag)) ? true : false);
+		return (math::is_small_value(abs(diag - (T)DIM) + abs(nondiag)) ? true : false);
 	}
 
 	template<typename T, size_t DIM, size_t RANK = 2>
@@ -371,7 +476,7 @@ namespace tens {
 			break;
 		}
 		if (!check_ort(Q)) {
-			throw new ErrorMath::NonOrthogonal();
+			throw ErrorMath::NonOrthogonal();
 		}
 		return Q;
 	}
@@ -392,7 +497,7 @@ namespace tens {
 		if (!check_ort(object)) {
 			throw ErrorMath::NonOrthogonal();
 		}
-		return std::make_shared<const container<T, DIM, RANK>>(object);
+		return std::make_shared<container<T, DIM, RANK>>(object);
 	}
 
 	template<typename T, size_t DIM, size_t RANK>
@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+	Hot-path instrumentation: calls and cumulative time of measure equations (per measure name) and of kernels
+	(eigen, inverse, change of basis, curve lookup). Compiled out unless TENS_PROFILE is defined.
+	Every thread accumulates into its own block, snapshot() sums blocks of all threads (live and finished).
+*/
+
+#ifdef TENS_PROFILE
+#define TENS_PROFILE_SCOPE(name) ::profile::Scope _profile_scope(::profile::counter::name)
+#define TENS_PROFILE_MEASURE_SCOPE(name, slot) ::profile::Scope _profile_scope(::profile::counter::name, slot)
+#else
+#define TENS_PROFILE_SCOPE(name)
+#define TENS_PROFILE_MEASURE_SCOPE(name, slot)
+#endif
+
+namespace profile {
+	enum class counter : uint8_t {
+		// per measure
+		RATE_EQUATION,
+		FINITE_EQUATION,
+		INTEGRATE_VALUE,
+		CALC_RATE,
+		// kernels
+		EIGEN,
+		INVERSE,
+		CHANGE_BASIS, // get_comp_at_basis with another basis
+		CURVE_LOOKUP
+	};
+	constexpr size_t COUNTER_COUNT = 8;
+	constexpr size_t MEASURE_COUNTER_COUNT = 4;
+	// slot 0 is for kernels, the last one is shared by measure names over the limit
+	constexpr size_t MAX_SLOTS = 64;
+
+	inline const char* to_string(counter c) {
+		const char* names[COUNTER_COUNT] = { "rate_equation", "finite_equation", "integrate_value", "calc_rate", "eigen", "inverse", "change_basis", "curve_lookup" };
+		return names[static_cast<size_t>(c)];
+	}
+
+	struct Entry {
+		uint64_t calls = 0;
+		uint64_t ns = 0;
+	};
+
+	// accumulators of one thread, written only by the owner (relaxed atomics make concurrent snapshots well-defined)
+	struct Block {
+		std::array<std::array<std::atomic<uint64_t>, COUNTER_COUNT>, MAX_SLOTS> calls{};
+		std::array<std::array<std::atomic<uint64_t>, COUNTER_COUNT>, MAX_SLOTS> ns{};
+
+		void add(size_t slot, counter c, uint64_t elapsed) {
+			auto& n = calls[slot][static_cast<size_t>(c)];
+			auto& t = ns[slot][static_cast<size_t>(c)];
+			n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			t.store(t.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+		}
+	};
+
+	struct Snapshot {
+		std::vector<std::string> names; // of slots
+		std::vector<std::array<Entry, COUNTER_COUNT>> slots;
+
+		// over all measures
+		Entry total(counter c) const {
+			Entry res;
+			for (const auto& slot : slots) {
+				res.calls += slot[static_cast<size_t>(c)].calls;
+				res.ns += slot[static_cast<size_t>(c)].ns;
+			}
+			return res;
+		}
+
+		void write_json(std::ostream& out) const {
+			const auto entry = [&](counter c, const Entry& e) {
+				out << "\"" << to_string(c) << "\": { \"calls\": " << e.calls << ", \"ns\": " << e.ns << " }";
+			};
+			out << "{\n  \"measures\": {";
+			bool first = true;
+			for (size_t slot = 1; slot < slots.size(); ++slot) {
+				out << (first ? "\n" : ",\n") << "    \"" << names[slot] << "\": { ";
+				first = false;
+				for (size_t c = 0; c < MEASURE_COUNTER_COUNT; ++c) {
+					if (c) out << ", ";
+					entry(counter(c), slots[slot][c]);
+				}
+				out << " }";
+			}
+			out << "\n  },\n  \"kernels\": { ";
+			for (size_t c = MEASURE_COUNTER_COUNT; c < COUNTER_COUNT; ++c) {
+				if (c != MEASURE_COUNTER_COUNT) out << ", ";
+				entry(counter(c), total(counter(c)));
+			}
+			out << " }\n}\n";
+		}
+	};
+
+	class Registry {
+		std::mutex _mutex;
+		std::vector<Block*> _live;
+		std::array<std::array<Entry, COUNTER_COUNT>, MAX_SLOTS> _retired{};
+		std::vector<std::string> _names = { "kernels" };
+
+		void merge(const Block& block, std::array<std::array<Entry, COUNTER_COUNT>, MAX_SLOTS>& dst) {
+			for (size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+				for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+					dst[slot][c].calls += block.calls[slot][c].load(std::memory_order_relaxed);
+					dst[slot][c].ns += block.ns[slot][c].load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	public:
+		void attach(Block* block) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_live.push_back(block);
+		}
+
+		// counters of a finished thread are kept
+		void detach(Block* block) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			merge(*block, _retired);
+			_live.erase(std::find(_live.begin(), _live.end(), block));
+		}
+
+		size_t slot(const std::string& name) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			const auto it = std::find(_names.begin(), _names.end(), name);
+			if (it != _names.end()) {
+				return it - _names.begin();
+			}
+			if (_names.size() == MAX_SLOTS - 1) {
+				_names.push_back("other");
+			}
+			if (_names.size() == MAX_SLOTS) {
+				return MAX_SLOTS - 1;
+			}
+			_names.push_back(name);
+			return _names.size() - 1;
+		}
+
+		Snapshot snapshot() {
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto totals = _retired;
+			for (const auto block : _live) {
+				merge(*block, totals);
+			}
+			Snapshot res;
+			res.names = _names;
+			res.slots.assign(totals.begin(), totals.begin() + _names.size());
+			return res;
+		}
+
+		// should be called when no steps are running
+		void reset() {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_retired = {};
+			for (const auto block : _live) {
+				for (size_t slot = 0; slot < MAX_SLOTS; ++slot) {
+					for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+						block->calls[slot][c].store(0, std::memory_order_relaxed);
+						block->ns[slot][c].store(0, std::memory_order_relaxed);
+					}
+				}
+			}
+		}
+	};
+
+	inline Registry& registry() {
+		static Registry instance;
+		return instance;
+	}
+
+	class ThreadBlock {
+		Block _block;
+	public:
+		ThreadBlock() { registry().attach(&_block); };
+		~ThreadBlock() { registry().detach(&_block); };
+		Block& block() { return _block; };
+	};
+
+	inline Block& local() {
+		thread_local ThreadBlock block;
+		return block.block();
+	}
+
+	// slot of the measure name: a name is registered once (under the lock of the registry), then it is found in the cache of the thread
+	inline size_t slot(const std::string& name) {
+		thread_local std::unordered_map<std::string, size_t> cache;
+		const auto it = cache.find(name);
+		if (it != cache.end()) {
+			return it->second;
+		}
+		return cache.emplace(name, registry().slot(name)).first->second;
+	}
+
+	inline Snapshot snapshot() {
+		return registry().snapshot();
+	}
+
+	inline void reset() {
+		registry().reset();
+	}
+
+	class Scope {
+		const size_t _slot;
+		const counter _counter;
+		const std::chrono::steady_clock::time_point _start;
+	public:
+		Scope(counter c, size_t slot = 0) : _slot(slot), _counter(c), _start(std::chrono::steady_clock::now()) {};
+		~Scope() {
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+			local().add(_slot, _counter, static_cast<uint64_t>(elapsed));
+		};
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+}
@@ -13,7 +13,7 @@ namespace tens {
 	{
 	public:
 		quat() : container<T, 4, 1>() { (*this)[0] = (T)1; };
-		explicit quat(const quat& q) ;
+		quat(const quat& q);
 		explicit quat(const container<T, 4, 1>& q) : container<T, 4, 1>(q) {};
 		explicit quat(const T& re, const container<T, 4, 1>& im, QUATFORM type);
 
@@ -52,9 +52,7 @@ namespace tens {
 	};
 
 	template<typename T>
-	quat<T>::quat(const quat& q ) {
-		this->set(0, q.get(0));
-		set_im(q.get_im());
+	quat<T>::quat(const quat& q ) : container<T, 4, 1>(q) {
 	};
 
 	template<typename T>
@@ -76,7 +74,7 @@ namespace tens {
 
 	template<typename T>
 	inline T quat<T>::re() const{
-		return this->get(0);
+		return (*this)[0];
 	}
 
 	template<typename T>
@@ -105,14 +103,13 @@ namespace tens {
 
 	template<typename T>
 	inline quat<T>  quat<T>::operator * (const quat<T>& rhs) const{
+		// (lr, lv) * (rr, rv) = (lr * rr - lv.rv, lr * rv + rr * lv + lv x rv)
+		const auto& l = *this;
 		quat<T> res;
-		container<T, 3, 1> lv = get_im();
-		container<T, 3, 1> rv = rhs.get_im();
-		T lr = re();
-		T rr = rhs.re();
-
-		res.set(0, lr * rr - lv * rv);
-		res.set_im(rv * lr + lv * rr + lv.vector_product(rv));
+		res[0] = l[0] * rhs[0] - l[1] * rhs[1] - l[2] * rhs[2] - l[3] * rhs[3];
+		res[1] = l[0] * rhs[1] + l[1] * rhs[0] + l[2] * rhs[3] - l[3] * rhs[2];
+		res[2] = l[0] * rhs[2] + l[2] * rhs[0] + l[3] * rhs[1] - l[1] * rhs[3];
+		res[3] = l[0] * rhs[3] + l[3] * rhs[0] + l[1] * rhs[2] - l[2] * rhs[1];
 		return res;
 	}
 
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+/*
+	Allocation tracking of the test build: global operator new/delete are replaced in test_leak.cpp
+	and count heap allocations of the current thread
+*/
+namespace alloc_tracking {
+	// allocations of the current thread since its start
+	size_t allocations();
+
+	// allocations of the current thread inside the scope
+	class Scope {
+		const size_t _start;
+	public:
+		Scope() : _start(alloc_tracking::allocations()) {};
+		size_t allocations() const { return alloc_tracking::allocations() - _start; };
+	};
+}
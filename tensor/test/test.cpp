@@ -3,6 +3,7 @@
 void run_test(){
     test_vector();
     test_tensor();
+    test_state();
     //test_factory();
-    //test_leak();
+    test_leak();
 }
\ No newline at end of file
@@ -1,34 +1,91 @@
 #include "test.h"
+#include <cstdlib>
+#include <new>
+#include "alloc_tracking.h"
+#include "../tensor-matrix/models/factory.h"
+
+// ---------------------------- allocation tracking of the test build ----------------------------
+namespace {
+    thread_local size_t thread_allocations = 0;
+
+    void* counted_alloc(std::size_t size) {
+        ++thread_allocations;
+        if (void* ptr = std::malloc(size ? size : 1)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+size_t alloc_tracking::allocations() {
+    return thread_allocations;
+}
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+    // steps after the first one (elastic and plastic parts of the loading) must not allocate
+    template<class Model>
+    size_t steady_step_allocations(const json& params, measure::type_schema type) {
+        Model point(model::ModelParams<double>::parse(params), tens::create_basis<double, 3>(), type);
+        point.step(1e-5);
+        const alloc_tracking::Scope scope;
+        for (size_t i = 0; i < 500; ++i) {
+            point.step(1e-5);
+        }
+        return scope.allocations();
+    }
+}
 
 void test_leak(){
-/*    using namespace tens;
-    for (size_t i = 0; i < 1e6; i++)
+    using namespace model;
+
+    std::cout << " =================== Start testing Leak ===================" << std::endl;
+    int all_tests = 0;
+    int pass_tests = 0;
+    auto params = json::parse(R"({
+        "elast_modulus": [ 210e3, 81e3 ],
+        "flow_treshold": 150,
+        "curve": [ [ 0.0, 0.0 ], [ 0.002, 0.1 ], [ 0.01, 0.8 ], [ 1.0, 1.0 ] ]
+    })");
+    auto return_mapping_params = params;
+    return_mapping_params["return_mapping"] = json::object();
+
     {
+        const auto m = tens::Matrix<double, 3>(tens::FILL_TYPE::RANDOM);
+        const alloc_tracking::Scope scope;
+        const auto res = tens::func(m * m.transpose(), std::log);
+        const size_t allocations = scope.allocations();
+        pass_tests += expect(allocations == 0, "func of matrix does not allocate");
+        all_tests++;
+    }
+    for (const auto type : { measure::type_schema::RATE_CALCULATE, measure::type_schema::FINITE_CALCULATE }) {
+        const std::string schema = type == measure::type_schema::RATE_CALCULATE ? "rate" : "finite";
         {
-            auto b1 = create_basis<double, 3>(DEFAULT_ORTH_BASIS::RANDOM);
-            auto b2 = create_basis<double, 3>(DEFAULT_ORTH_BASIS::RANDOM);
-            //auto f1 = factory::state<double, 3>(b1);
-            //auto f2 = factory::state<double, 3>(b1);
-            {
-                auto m1 = Matrix<double, 3>(); m1.fill_rand();
-                auto m2 = Matrix<double, 3>(); m2.fill_rand();
-
-                auto t11 = Tensor<double, 3>(m1, b1);
-                auto t12 = Tensor<double, 3>(m2, b2);
-                auto t21 = t11;
-                auto t31 = std::move(t21);
-                t11 = std::move(t12);
-            }
-            {
-                auto a1 = Array<double, 3>(FILL_TYPE::RANDOM);
-                auto a2 = Array<double, 3>(FILL_TYPE::RANDOM);
-                auto v11 = Vector<double, 3>(a1, b1);
-                auto v12 = Vector<double, 3>(a2, b1);
-                auto v21 = v11;
-                auto v31 = std::move(v21);
-                v11 = std::move(v12);
-            }
+            const size_t allocations = steady_step_allocations<Elasticity<strain::GradDeform, stress::CaushyStress, double>>(params, type);
+            pass_tests += expect(allocations == 0, "steady-state step of Elasticity (" + schema + ") does not allocate, allocations: " + std::to_string(allocations));
+            all_tests++;
+        }
+        {
+            const size_t allocations = steady_step_allocations<Plasticity<strain::GradDeform, stress::CaushyStress, double>>(params, type)
+                + (type == measure::type_schema::RATE_CALCULATE
+                    ? steady_step_allocations<Plasticity<strain::GradDeform, stress::CaushyStress, double>>(return_mapping_params, type) : 0);
+            pass_tests += expect(allocations == 0, "steady-state step of Plasticity (" + schema + ") does not allocate, allocations: " + std::to_string(allocations));
+            all_tests++;
         }
     }
-    */
-}
\ No newline at end of file
+
+    std::cout << " Test passed : " << std::to_string(pass_tests) << "/" << std::to_string(all_tests) << std::endl;
+    std::cout << " ==================== End Testing Leak ====================" << std::endl;
+}
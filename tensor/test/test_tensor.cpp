@@ -1,4 +1,6 @@
 #include "test.h"
+#include <sstream>
+#include <thread>
 
 double forward_pow_3(double x) {
     return x * x * x;
@@ -17,6 +19,12 @@ double backward_log(double x) {
     return log(x);
 };
 
+// object that gives out a reference to its components (as measures do)
+struct LinkedTensor : public tens::object<double, 3, 2> {
+    using tens::object<double, 3, 2>::object;
+    tens::container<double, 3, 2>& link() { return comp(); }
+};
+
 
 void test_tensor(){
     using namespace tens;
@@ -188,6 +196,142 @@ void test_tensor(){
         pass_tests += expect((M - m1sqr) == m_zero, "eigen+func (sqr->sqrt) of matrix test");
         all_tests++;
     }
+    {
+        // copy-on-write: copies share components until written, linked components are not shared
+        auto copy = t11;
+        const bool shared = &copy.get_comp_ref() == &t11.get_comp_ref() && copy.get_basis_ref() != t11.get_basis_ref() && *copy.get_basis_ref() == *t11.get_basis_ref();
+        copy *= 2.0;
+        const bool detached = &copy.get_comp_ref() != &t11.get_comp_ref() && t11.get_comp_ref() == m1 && copy.get_comp_ref() == m1 * 2.0;
+        copy.recalc_basis(basis2);
+        const bool own_basis = t11.get_basis_ref() == basis1 && *basis1 != *basis2 && copy == t11 * 2.0;
+        LinkedTensor linked(m1, basis1);
+        auto& ref = linked.link();
+        const auto snapshot = tens::object<double, 3, 2>(linked);
+        ref *= 3.0;
+        bool pinned = &snapshot.get_comp_ref() != &ref && snapshot.get_comp_ref() == m1 && linked.get_comp_ref() == m1 * 3.0;
+        // linked components moved into an object of the same basis stay pinned
+        LinkedTensor source(m1, basis1);
+        auto& source_ref = source.link();
+        tens::object<double, 3, 2> moved(m_zero, basis1);
+        moved = std::move(source);
+        const auto moved_copy = moved;
+        source_ref *= 5.0;
+        pinned = pinned && &moved.get_comp_ref() == &source_ref && moved_copy.get_comp_ref() == m1 && moved.get_comp_ref() == m1 * 5.0;
+        // objects built on one basis see its changes in place, copies do not
+        tens::object<double, 3, 2> on_basis(m1, basis1), other_on_basis(m1, basis1);
+        const auto basis_copy = other_on_basis;
+        const auto old_basis = *basis1;
+        on_basis.recalc_basis(basis2);
+        const bool in_place = on_basis.get_basis_ref() == basis1 && *other_on_basis.get_basis_ref() == *basis2 && *basis_copy.get_basis_ref() == old_basis;
+        *basis1 = old_basis;
+        pass_tests += expect(shared && detached && own_basis && pinned && in_place, "copy-on-write components of objects");
+        all_tests++;
+    }
+    {
+        // forward mode AD: derivatives of det, inverse and ln of a symmetric positive matrix M(a, b) against central differences
+        using D = ad::Dual<double, 2>;
+        const auto matrix = [](auto a, auto b) {
+            using V = decltype(a);
+            return tens::container<V, 3, 2>(std::array<V, 9>{ 2.0 + a, 3.0, 1.5 + b, 0.2 * a, 0.3, 0.1 * b, 0.2 * a, 0.3, 0.1 * b });
+        };
+        const double a = 0.3, b = -0.2, h = 1e-6;
+        const auto M = matrix(ad::make_variable<2>(a, 0), ad::make_variable<2>(b, 1));
+        const auto det = M.det();
+        const auto inv = M.inverse();
+        const auto ln = func(M, ad::log);
+        const auto ei = eigen(M);
+        double err = 0;
+        for (size_t k = 0; k < 2; k++) {
+            const auto Mp = matrix(a + (k == 0 ? h : 0), b + (k == 1 ? h : 0));
+            const auto Mm = matrix(a - (k == 0 ? h : 0), b - (k == 1 ? h : 0));
+            err += fabs(det.d[k] - (Mp.det() - Mm.det()) / (2 * h));
+            const auto eip = eigen(Mp);
+            const auto eim = eigen(Mm);
+            for (size_t c = 0; c < 9; c++) {
+                err += fabs(ei.first[c].d[k] - (eip.first[c] - eim.first[c]) / (2 * h));
+                err += fabs(ei.second[c].d[k] - (eip.second[c] - eim.second[c]) / (2 * h));
+            }
+            const auto dinv = (Mp.inverse() - Mm.inverse()) / (2 * h);
+            const auto dln = (func(Mp, log) - func(Mm, log)) / (2 * h);
+            for (size_t c = 0; c < 9; c++) {
+                err += fabs(inv[c].d[k] - dinv[c]) + fabs(ln[c].d[k] - dln[c]);
+            }
+        }
+        const auto ln0 = func(matrix(a, b), log);
+        err += fabs(det.v - matrix(a, b).det());
+        for (size_t c = 0; c < 9; c++) {
+            err += fabs(ln[c].v - ln0[c]);
+        }
+        pass_tests += expect(err < 1e-6, "dual numbers: derivatives of det, inverse, eigen and func");
+        all_tests++;
+    }
+
+    {
+        // trace export: names are escaped, events exported while the owner thread records are complete (not torn)
+        trace::Registry registry;
+        const std::string name = "S \"quoted\" \\ \n\t\x01";
+        const uint32_t id = registry.intern(name);
+        registry.set_capacity(64);
+        const auto buffer = registry.create_buffer();
+        std::atomic<bool> done{ false };
+        std::thread writer([&] {
+            for (int64_t k = 1; k <= 200000; ++k) buffer->push({ k * 1000, k * 1000, id, trace::category::measure });
+            done = true;
+        });
+        bool valid = true;
+        size_t exported = 0;
+        while (!done || exported == 0) {
+            std::ostringstream out;
+            registry.write_json(out);
+            const auto doc = json::parse(out.str());
+            for (const auto& event : doc["traceEvents"]) {
+                if (event["ph"] != "X") continue;
+                valid = valid && event["name"] == name && event["ts"] == event["dur"];
+                exported++;
+            }
+        }
+        writer.join();
+
+        // buffers of exited threads are taken by new ones: repeated short-lived workers do not add buffers
+        trace::set_capacity(64);
+        trace::start();
+        const auto record = [] { trace::Scope scope(trace::STEP, trace::category::schema); };
+        record();
+        const size_t buffers = trace::registry().buffer_count();
+        for (size_t pass = 0; pass < 20; ++pass) {
+            std::vector<std::thread> pool;
+            for (size_t i = 0; i < 3; ++i) pool.emplace_back(record);
+            for (auto& thread : pool) thread.join();
+        }
+        trace::stop();
+        trace::clear();
+        trace::set_capacity(size_t(1) << 16);
+        valid = valid && trace::registry().buffer_count() <= buffers + 3;
+        pass_tests += expect(valid && exported > 0, "trace: concurrent export of events, escaping of names, reuse of buffers");
+        all_tests++;
+    }
+
+    {
+        // profile: scopes of live and finished threads are summed per slot of the name, a name is registered once
+        const size_t slot = profile::slot("test_profile_measure");
+        const auto before = profile::snapshot();
+        const auto calls = [&](const profile::Snapshot& snapshot) { return snapshot.slots[slot][size_t(profile::counter::RATE_EQUATION)].calls; };
+        const auto record = [&] {
+            for (size_t i = 0; i < 3; ++i) profile::Scope scope(profile::counter::RATE_EQUATION, profile::slot("test_profile_measure"));
+            profile::Scope kernel(profile::counter::EIGEN);
+        };
+        size_t other_slot = 0;
+        std::thread finished([&] {
+            record();
+            other_slot = profile::slot("test_profile_measure");
+        });
+        finished.join();
+        record();
+        const auto after = profile::snapshot();
+        pass_tests += expect(other_slot == slot && after.names[slot] == "test_profile_measure" && calls(after) - calls(before) == 6
+            && after.total(profile::counter::EIGEN).calls - before.total(profile::counter::EIGEN).calls == 2, "profile: scopes are recorded and aggregated over threads");
+        all_tests++;
+    }
     
     std::cout << " Test passed : " << std::to_string(pass_tests) << "/" << std::to_string(all_tests) << std::endl;
     std::cout << " ==================== End Testing Tensor ====================" << std::endl;
@@ -0,0 +1,260 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+	Timeline of model steps in Chrome trace-event format (chrome://tracing, ui.perfetto.dev).
+	Compiled out unless TENS_TRACE is defined, recording is switched by trace::start()/trace::stop().
+	Every thread writes complete events (begin + duration) into its own ring buffer without locks,
+	the oldest events are overwritten when the buffer is full. A buffer returns to the registry when its thread exits
+	and is taken by the next new thread, so the number of buffers (tracks) is the maximum number of threads recorded at once.
+*/
+
+#ifdef TENS_TRACE
+#define TENS_TRACE_SCOPE(name_id, cat) ::trace::Scope _trace_scope(name_id, ::trace::category::cat)
+#else
+#define TENS_TRACE_SCOPE(name_id, cat)
+#endif
+
+namespace trace {
+	// predefined names, ids of other names (measures) are given by intern()
+	enum predefined : uint32_t {
+		STEP,
+		INIT,
+		CALC,
+		FINALIZE
+	};
+
+	enum class category : uint8_t {
+		schema,
+		measure
+	};
+
+	inline const char* to_string(category c) {
+		return c == category::schema ? "schema" : "measure";
+	}
+
+	struct Event {
+		int64_t begin = 0; // ns from the start of the process
+		int64_t duration = 0;
+		uint32_t name = 0;
+		category cat = category::schema;
+	};
+
+	/*
+		single writer (the owner thread), readers may copy events concurrently:
+		fields of a slot are relaxed atomics guarded by the sequence number of the slot (index of its event + 1, 0 while it is written),
+		the reader keeps an event only if the sequence number is the expected one before and after the copy
+	*/
+	class RingBuffer {
+		struct Slot {
+			std::atomic<uint64_t> seq{ 0 };
+			std::atomic<int64_t> begin{ 0 };
+			std::atomic<int64_t> duration{ 0 };
+			std::atomic<uint32_t> name{ 0 };
+			std::atomic<category> cat{ category::schema };
+		};
+
+		std::vector<Slot> _slots;
+		std::atomic<uint64_t> _head{ 0 };
+	public:
+		const uint32_t tid;
+
+		RingBuffer(size_t capacity, uint32_t _tid) : _slots(std::max<size_t>(1, capacity)), tid(_tid) {};
+
+		void push(const Event& event) {
+			const uint64_t head = _head.load(std::memory_order_relaxed);
+			auto& slot = _slots[head % _slots.size()];
+			slot.seq.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.begin.store(event.begin, std::memory_order_relaxed);
+			slot.duration.store(event.duration, std::memory_order_relaxed);
+			slot.name.store(event.name, std::memory_order_relaxed);
+			slot.cat.store(event.cat, std::memory_order_relaxed);
+			slot.seq.store(head + 1, std::memory_order_release);
+			_head.store(head + 1, std::memory_order_release);
+		}
+
+		std::vector<Event> events() const {
+			const uint64_t head = _head.load(std::memory_order_acquire);
+			const uint64_t first = head > _slots.size() ? head - _slots.size() : 0;
+			std::vector<Event> res;
+			res.reserve(head - first);
+			for (uint64_t i = first; i < head; ++i) {
+				const auto& slot = _slots[i % _slots.size()];
+				if (slot.seq.load(std::memory_order_acquire) != i + 1) continue; // overwritten
+				const Event event{ slot.begin.load(std::memory_order_relaxed), slot.duration.load(std::memory_order_relaxed),
+					slot.name.load(std::memory_order_relaxed), slot.cat.load(std::memory_order_relaxed) };
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.seq.load(std::memory_order_relaxed) != i + 1) continue; // overwritten during the copy
+				res.push_back(event);
+			}
+			return res;
+		}
+
+		// should be called when the owner thread does not record
+		void clear() {
+			_head.store(0, std::memory_order_release);
+		}
+	};
+
+	// string of a JSON document
+	inline void write_json_string(std::ostream& out, const std::string& str) {
+		static const char hex[] = "0123456789abcdef";
+		out << '"';
+		for (const char ch : str) {
+			switch (ch) {
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\r': out << "\\r"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(ch) < 0x20) {
+					out << "\\u00" << hex[(ch >> 4) & 0xf] << hex[ch & 0xf];
+				} else {
+					out << ch;
+				}
+			}
+		}
+		out << '"';
+	}
+
+	class Registry {
+		std::mutex _mutex;
+		std::vector<std::shared_ptr<RingBuffer>> _buffers; // kept after the exit of the thread
+		std::vector<std::shared_ptr<RingBuffer>> _free;    // buffers of exited threads
+		std::vector<std::string> _names = { "step", "init", "calc", "finalize" };
+		size_t _capacity = size_t(1) << 16;
+		const std::chrono::steady_clock::time_point _epoch = std::chrono::steady_clock::now();
+	public:
+		std::atomic<bool> enabled{ false };
+
+		int64_t now() const {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count();
+		}
+
+		uint32_t intern(const std::string& name) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			const auto it = std::find(_names.begin(), _names.end(), name);
+			if (it != _names.end()) {
+				return static_cast<uint32_t>(it - _names.begin());
+			}
+			_names.push_back(name);
+			return static_cast<uint32_t>(_names.size() - 1);
+		}
+
+		// events per thread, for buffers created after the call
+		void set_capacity(size_t capacity) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_capacity = capacity;
+		}
+
+		std::shared_ptr<RingBuffer> create_buffer() {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_buffers.push_back(std::make_shared<RingBuffer>(_capacity, static_cast<uint32_t>(_buffers.size())));
+			return _buffers.back();
+		}
+
+		// a buffer of an exited thread (its events are kept) or a new one
+		std::shared_ptr<RingBuffer> acquire_buffer() {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_free.empty()) {
+					auto buffer = std::move(_free.back());
+					_free.pop_back();
+					return buffer;
+				}
+			}
+			return create_buffer();
+		}
+
+		// the owner thread does not record anymore
+		void release_buffer(const std::shared_ptr<RingBuffer>& buffer) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_free.push_back(buffer);
+		}
+
+		size_t buffer_count() {
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _buffers.size();
+		}
+
+		void clear() {
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (const auto& buffer : _buffers) {
+				buffer->clear();
+			}
+		}
+
+		void write_json(std::ostream& out) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+			bool first = true;
+			for (const auto& buffer : _buffers) {
+				out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+					<< ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+				first = false;
+				for (const auto& e : buffer->events()) {
+					// timestamps are in microseconds
+					out << ",\n{\"name\": ";
+					write_json_string(out, _names[e.name]);
+					out << ", \"cat\": \"" << to_string(e.cat) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+						<< ", \"ts\": " << e.begin / 1000 << "." << std::to_string(1000 + e.begin % 1000).substr(1)
+						<< ", \"dur\": " << e.duration / 1000 << "." << std::to_string(1000 + e.duration % 1000).substr(1) << "}";
+				}
+			}
+			out << "\n]}\n";
+		}
+	};
+
+	inline Registry& registry() {
+		static Registry instance;
+		return instance;
+	}
+
+	// buffer of the thread, returned to the registry at the exit of the thread
+	class Lease {
+		const std::shared_ptr<RingBuffer> _buffer;
+	public:
+		Lease() : _buffer(registry().acquire_buffer()) {};
+		~Lease() { registry().release_buffer(_buffer); };
+		RingBuffer& buffer() const { return *_buffer; };
+	};
+
+	inline RingBuffer& local() {
+		thread_local const Lease lease;
+		return lease.buffer();
+	}
+
+	inline uint32_t intern(const std::string& name) { return registry().intern(name); }
+	inline void start() { registry().enabled.store(true, std::memory_order_relaxed); }
+	inline void stop() { registry().enabled.store(false, std::memory_order_relaxed); }
+	inline void clear() { registry().clear(); }
+	inline void set_capacity(size_t events_per_thread) { registry().set_capacity(events_per_thread); }
+	// may be called while threads record (events overwritten during the export are skipped)
+	inline void write_json(std::ostream& out) { registry().write_json(out); }
+
+	class Scope {
+		const int64_t _begin;
+		const uint32_t _name;
+		const category _cat;
+	public:
+		Scope(uint32_t name, category cat) :
+			_begin(registry().enabled.load(std::memory_order_relaxed) ? registry().now() : -1), _name(name), _cat(cat) {};
+		~Scope() {
+			if (_begin >= 0) {
+				local().push({ _begin, registry().now() - _begin, _name, _cat });
+			}
+		};
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+}
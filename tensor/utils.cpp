@@ -20,6 +20,16 @@ tens::container<double, 3, 2> tens::generate_rand_ort() {
 	return get_ort_matrix<double>(q);
 }
 
+tens::container<double, 3, 2> tens::generate_rand_ort(std::mt19937& engine) {
+	std::uniform_real_distribution<double> distr(0.0, 1.0);
+	container<double, 4, 1> arr_rand;
+	for (size_t i = 0; i < arr_rand.size(); ++i) {
+		arr_rand[i] = distr(engine);
+	}
+	quat<double> q(arr_rand);
+	return get_ort_matrix<double>(q);
+}
+
 tens::container<double, 3, 2> tens::generate_indent_ort() {
 	quat<double> q;
 	return get_ort_matrix<double>(q);